@@ -1,10 +1,46 @@
 #include "domain.h"
 
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
 namespace domain {
 
-std::string_view Commands::AddId(const std::string& id) {
-    ids_.push_front(id);
-    return {ids_.front().begin(), ids_.front().end()};
+std::string_view Commands::AddId(std::string_view id) {
+    if (const auto it = id_index_.find(id); it != id_index_.end()) {
+        return *it;
+    }
+    const auto in_text = [id](const std::shared_ptr<const std::string>& text) {
+        const std::less_equal<const char*> not_after;
+        return not_after(text->data(), id.data()) && not_after(id.data() + id.size(), text->data() + text->size());
+    };
+    if (std::none_of(texts_.begin(), texts_.end(), in_text)) {
+        ids_.push_front(std::string {id});
+        id = ids_.front();
+    }
+    id_index_.insert(id);
+    return id;
+}
+
+void Commands::KeepText(std::shared_ptr<const std::string> text) {
+    if (text) {
+        texts_.push_back(std::move(text));
+    }
+}
+
+void Commands::Append(Commands&& other) {
+    std::move(other.stop_requests.begin(), other.stop_requests.end(), std::back_inserter(stop_requests));
+    std::move(other.bus_requests.begin(), other.bus_requests.end(), std::back_inserter(bus_requests));
+    std::move(other.stat_requests.begin(), other.stat_requests.end(), std::back_inserter(stat_requests));
+    other.stop_requests.clear();
+    other.bus_requests.clear();
+    other.stat_requests.clear();
+    // узлы списка переносятся без копирования строк
+    ids_.splice_after(ids_.before_begin(), other.ids_);
+    std::move(other.texts_.begin(), other.texts_.end(), std::back_inserter(texts_));
+    other.texts_.clear();
+    id_index_.merge(other.id_index_);
+    other.id_index_.clear();
 }
     
 }
@@ -7,6 +7,10 @@
 #include <vector>
 #include <unordered_map>
 #include <forward_list>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_set>
 #include <variant>
 
 namespace domain {
@@ -15,7 +19,10 @@ enum class StatType {
     Bus,
     Stop,
     Map,
-    Route
+    Route,
+    NearestStops,
+    MapTile,
+    RouteMap
 };
 
 struct Dist2Stop {
@@ -23,19 +30,20 @@ struct Dist2Stop {
     int distance;
 };
 
+// Имена в запросах базы - строки Commands::AddId
 struct StopDistance {
-    std::string stop;
+    std::string_view stop;
     int distance;
 };
 
 struct StopRequest {
-    std::string name;
+    std::string_view name;
     geo::Coordinates place;
     std::vector<StopDistance> road_distances;
 };
 
 struct BusRequest {
-    std::string name;
+    std::string_view name;
     std::vector<std::string_view> stops;
     std::vector<std::string_view> final_stops;
     bool is_roundtrip;
@@ -45,17 +53,36 @@ struct StatRequest {
     int id;
     StatType type;
     std::string name;
+    // Route, RouteMap: остановки начала и конца поездки
     std::string from;
     std::string to;
+    // NearestStops: без radius ищутся только остановки в самой точке place,
+    // без count число остановок в радиусе не ограничено
+    geo::Coordinates place {0., 0.};
+    double radius = 0.;
+    std::optional<int> count;
+    // MapTile: масштаб и номер плитки (столбец x, строка y)
+    int zoom = 0;
+    int x = 0;
+    int y = 0;
 };
 
 struct Commands {
     std::vector<StopRequest> stop_requests;
     std::vector<BusRequest> bus_requests;
     std::vector<StatRequest> stat_requests;
-    std::string_view AddId(const std::string& id);
+    // Строка с содержимым id, живущая вместе с командами. Одинаковые имена хранятся
+    // один раз; имя, лежащее в тексте из KeepText, не копируется
+    std::string_view AddId(std::string_view id);
+    // Текст входа, на который могут ссылаться строки AddId
+    void KeepText(std::shared_ptr<const std::string> text);
+    // Переносит команды other в конец этих; строки, выданные other.AddId, остаются действительными
+    void Append(Commands&& other);
 private:
     std::forward_list<std::string> ids_;
+    std::vector<std::shared_ptr<const std::string>> texts_;
+    // все строки, выданные AddId
+    std::unordered_set<std::string_view> id_index_;
 };
 
 struct Offset {
@@ -83,6 +110,12 @@ struct RenderSettings {
     svg::Color underlayer_color;
     double underlayer_width;
     ColorPalette color_palette;
+    // Допуск упрощения линий маршрутов в пикселях, 0 - без упрощения
+    double simplify_tolerance = 0.;
+    // Общее оформление объектов выводится классами CSS в блоке <style>, а не атрибутами
+    bool style_classes = false;
+
+    bool operator==(const RenderSettings& other) const = default;
 };
 
 }
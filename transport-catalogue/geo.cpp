@@ -1,8 +1,13 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
 #include <cmath>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 namespace geo {
 
 const int EARTH_RAD = 6371000;
@@ -15,4 +20,84 @@ double ComputeDistance(Coordinates from, Coordinates to) {
         * EARTH_RAD;
 }
 
+namespace {
+
+// cos(lng1 - lng2) = cos(lng1) * cos(lng2) + sin(lng1) * sin(lng2), поэтому
+// косинус центрального угла выражается через заранее посчитанные значения.
+// Аргумент acos зажимается в [-1, 1]: для совпадающих точек он может выйти за единицу.
+double ArcLength(double cos_angle) {
+    return std::acos(std::clamp(cos_angle, -1., 1.)) * EARTH_RAD;
+}
+
+}  // namespace
+
+size_t CoordinatesTable::Add(Coordinates place) {
+    const size_t index = Size();
+    sin_lat_.emplace_back();
+    cos_lat_.emplace_back();
+    sin_lng_.emplace_back();
+    cos_lng_.emplace_back();
+    Set(index, place);
+    return index;
+}
+
+void CoordinatesTable::Set(size_t index, Coordinates place) {
+    const double dr = M_PI / 180.0;
+    sin_lat_.at(index) = std::sin(place.lat * dr);
+    cos_lat_.at(index) = std::cos(place.lat * dr);
+    sin_lng_.at(index) = std::sin(place.lng * dr);
+    cos_lng_.at(index) = std::cos(place.lng * dr);
+}
+
+size_t CoordinatesTable::Size() const {
+    return sin_lat_.size();
+}
+
+void CoordinatesTable::Reserve(size_t count) {
+    sin_lat_.reserve(count);
+    cos_lat_.reserve(count);
+    sin_lng_.reserve(count);
+    cos_lng_.reserve(count);
+}
+
+void CoordinatesTable::ComputeDistances(const size_t* from, const size_t* to, size_t count, double* distances) const {
+    size_t i = 0;
+#if defined(__AVX2__)
+    static_assert(sizeof(size_t) == sizeof(long long), "gather indexes must be 64-bit");
+    for (; i + 4 <= count; i += 4) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(to + i));
+        const __m256d cos_lng = _mm256_add_pd(
+            _mm256_mul_pd(_mm256_i64gather_pd(cos_lng_.data(), a, 8), _mm256_i64gather_pd(cos_lng_.data(), b, 8)),
+            _mm256_mul_pd(_mm256_i64gather_pd(sin_lng_.data(), a, 8), _mm256_i64gather_pd(sin_lng_.data(), b, 8)));
+        const __m256d cos_angle = _mm256_add_pd(
+            _mm256_mul_pd(_mm256_i64gather_pd(sin_lat_.data(), a, 8), _mm256_i64gather_pd(sin_lat_.data(), b, 8)),
+            _mm256_mul_pd(_mm256_mul_pd(_mm256_i64gather_pd(cos_lat_.data(), a, 8), _mm256_i64gather_pd(cos_lat_.data(), b, 8)), cos_lng));
+        _mm256_storeu_pd(distances + i, cos_angle);
+        for (size_t j = i; j < i + 4; ++j) {
+            distances[j] = ArcLength(distances[j]);
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        const size_t a = from[i];
+        const size_t b = to[i];
+        const double cos_lng = cos_lng_[a] * cos_lng_[b] + sin_lng_[a] * sin_lng_[b];
+        distances[i] = ArcLength(sin_lat_[a] * sin_lat_[b] + cos_lat_[a] * cos_lat_[b] * cos_lng);
+    }
+}
+
+double CoordinatesTable::ComputePathLength(const std::vector<size_t>& path) const {
+    if (path.size() < 2) {
+        return 0.;
+    }
+    std::vector<double> distances(path.size() - 1);
+    ComputeDistances(path.data(), path.data() + 1, distances.size(), distances.data());
+    double length = 0.;
+    for (const double d : distances) {
+        length += d;
+    }
+    return length;
+}
+
 }  // namespace geo
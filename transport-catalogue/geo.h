@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
+#include <vector>
 
 namespace geo {
 
@@ -20,4 +22,28 @@ namespace geo {
 
     double ComputeDistance(Coordinates from, Coordinates to);
 
+    // Точки с заранее посчитанными синусами и косинусами широты и долготы,
+    // хранятся структурой массивов. Расстояние между двумя точками сводится
+    // к нескольким умножениям и одному acos, а пачка расстояний считается
+    // векторно (AVX2, если компилятор его поддерживает, иначе скалярно).
+    class CoordinatesTable {
+    public:
+        // Возвращает индекс добавленной точки
+        size_t Add(Coordinates place);
+        void Set(size_t index, Coordinates place);
+        size_t Size() const;
+        void Reserve(size_t count);
+
+        // distances[i] - расстояние между точками from[i] и to[i], i < count
+        void ComputeDistances(const size_t* from, const size_t* to, size_t count, double* distances) const;
+        // Длина ломаной, проходящей через точки path
+        double ComputePathLength(const std::vector<size_t>& path) const;
+
+    private:
+        std::vector<double> sin_lat_;
+        std::vector<double> cos_lat_;
+        std::vector<double> sin_lng_;
+        std::vector<double> cos_lng_;
+    };
+
 }
@@ -1,5 +1,11 @@
 #include "json.h"
+#include "json_scan.h"
+#include "json_writer.h"
 
+#include <cctype>
+#include <charconv>
+#include <deque>
+#include <fstream>
 #include <iterator>
 
 namespace json {
@@ -19,7 +25,7 @@ std::string LoadLiteral(std::istream& input) {
 }
 
 Node LoadArray(std::istream& input) {
-    std::vector<Node> result;
+    Array result;
 
     for (char c; input >> c && c != ']';) {
         if (c != ',') {
@@ -208,119 +214,572 @@ Node LoadNode(std::istream& input) {
     }
 }
 
-struct PrintContext {
-    std::ostream& out;
-    int indent_step = 4;
-    int indent = 0;
+// Разбор из непрерывного буфера: позиция - указатель, числа через std::from_chars.
+// Грамматика и сообщения об ошибках совпадают с разбором из std::istream.
+// Массивы и словари размещаются в resource
+class BufferParser {
+public:
+    // При share_strings строки без escape-последовательностей становятся BufferString,
+    // тогда input должен жить не меньше результата
+    BufferParser(std::string_view input, std::pmr::memory_resource* resource = std::pmr::get_default_resource(), bool share_strings = false)
+        : pos_(input.data())
+        , end_(input.data() + input.size())
+        , resource_(resource)
+        , share_strings_(share_strings) {
+    }
 
-    void PrintIndent() const {
-        for (int i = 0; i < indent; ++i) {
-            out.put(' ');
+    Node ParseNode() {
+        SkipSpaces();
+        if (pos_ == end_) {
+            throw ParsingError("Unexpected EOF"s);
+        }
+        if (!skip_.empty() && pos_ == skip_.data()) {
+            pos_ += skip_.size();
+            return Node(Array(resource_));
+        }
+        switch (*pos_) {
+            case '[':
+                ++pos_;
+                return ParseArray();
+            case '{':
+                ++pos_;
+                return ParseDict();
+            case '"':
+                ++pos_;
+                return share_strings_ ? ParseSharedString() : Node(ParseString());
+            case 't':
+                [[fallthrough]];
+            case 'f':
+                return ParseBool();
+            case 'n':
+                return ParseNull();
+            default:
+                return ParseNumber();
         }
     }
 
-    PrintContext Indented() const {
-        return {out, indent_step, indent_step + indent};
+    // Разбирает другой участок того же текста, сохраняя накопленные буферы
+    Node ParsePart(std::string_view part) {
+        pos_ = part.data();
+        end_ = part.data() + part.size();
+        return ParseNode();
     }
-};
-
-void PrintNode(const Node& value, const PrintContext& ctx);
 
-template <typename Value>
-void PrintValue(const Value& value, const PrintContext& ctx) {
-    ctx.out << value;
-}
+    // Значение, начинающееся в skip.data(), не разбирается и заменяется пустым массивом
+    void Skip(std::string_view skip) {
+        skip_ = skip;
+    }
 
-void PrintString(const std::string& value, std::ostream& out) {
-    out.put('"');
-    for (const char c : value) {
-        switch (c) {
-            case '\r':
-                out << "\\r"sv;
-                break;
-            case '\n':
-                out << "\\n"sv;
+    void ParseEvents(EventHandler& handler) {
+        SkipSpaces();
+        if (pos_ == end_) {
+            throw ParsingError("Unexpected EOF"s);
+        }
+        switch (*pos_) {
+            case '[':
+                ++pos_;
+                ParseArrayEvents(handler);
                 break;
-            case '\t':
-                out << "\\t"sv;
+            case '{':
+                ++pos_;
+                ParseDictEvents(handler);
                 break;
             case '"':
+                ++pos_;
+                handler.String(ParseStringView());
+                break;
+            case 't':
                 [[fallthrough]];
-            case '\\':
-                out.put('\\');
-                [[fallthrough]];
+            case 'f':
+                handler.Bool(ParseBool().AsBool());
+                break;
+            case 'n':
+                ParseNull();
+                handler.Null();
+                break;
             default:
-                out.put(c);
+                if (const Node number = ParseNumber(); number.IsInt()) {
+                    handler.Int(number.AsInt());
+                } else {
+                    handler.Double(number.AsDouble());
+                }
                 break;
         }
     }
-    out.put('"');
-}
 
-template <>
-void PrintValue<std::string>(const std::string& value, const PrintContext& ctx) {
-    PrintString(value, ctx.out);
-}
+private:
+    void ParseArrayEvents(EventHandler& handler) {
+        handler.StartArray();
+        char c;
+        bool closed = false;
+        while (NextChar(c)) {
+            if (c == ']') {
+                closed = true;
+                break;
+            }
+            if (c != ',') {
+                --pos_;
+            }
+            ParseEvents(handler);
+        }
+        if (!closed) {
+            throw ParsingError("Array parsing error"s);
+        }
+        handler.EndArray();
+    }
 
-template <>
-void PrintValue<std::nullptr_t>(const std::nullptr_t&, const PrintContext& ctx) {
-    ctx.out << "null"sv;
-}
+    void ParseDictEvents(EventHandler& handler) {
+        handler.StartDict();
+        const size_t first = event_keys_.size();
+        const size_t first_escaped = escaped_keys_.size();
+        char c;
+        bool closed = false;
+        while (NextChar(c)) {
+            if (c == '}') {
+                closed = true;
+                break;
+            }
+            if (c == '"') {
+                std::string_view key = ParseStringView();
+                if (NextChar(c) && c == ':') {
+                    handler.Key(key);
+                    // ключ с escape-последовательностями лежит в scratch_, который перезапишется
+                    if (key.data() == scratch_.data()) {
+                        key = escaped_keys_.emplace_back(key);
+                    }
+                    event_keys_.push_back(key);
+                    ParseEvents(handler);
+                } else {
+                    throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                }
+            } else if (c != ',') {
+                throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+            }
+        }
+        if (!closed) {
+            throw ParsingError("Dictionary parsing error"s);
+        }
+        // повторы ищутся, как в ParseDict: после всех элементов, среди отсортированных ключей
+        std::sort(event_keys_.begin() + first, event_keys_.end());
+        const auto duplicate = std::adjacent_find(event_keys_.begin() + first, event_keys_.end());
+        if (duplicate != event_keys_.end()) {
+            throw ParsingError("Duplicate key '"s + std::string(*duplicate) + "' have been found");
+        }
+        event_keys_.resize(first);
+        escaped_keys_.resize(first_escaped);
+        handler.EndDict();
+    }
 
-template <>
-void PrintValue<bool>(const bool& value, const PrintContext& ctx) {
-    ctx.out << (value ? "true"sv : "false"sv);
-}
+    static bool IsSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+    }
 
-template <>
-void PrintValue<Array>(const Array& nodes, const PrintContext& ctx) {
-    std::ostream& out = ctx.out;
-    out << "[\n"sv;
-    bool first = true;
-    auto inner_ctx = ctx.Indented();
-    for (const Node& node : nodes) {
-        if (first) {
-            first = false;
+    static bool IsDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    static bool IsAlpha(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    void SkipSpaces() {
+        while (pos_ != end_ && IsSpace(*pos_)) {
+            ++pos_;
+        }
+    }
+
+    // Следующий непробельный символ, как input >> c
+    bool NextChar(char& c) {
+        SkipSpaces();
+        if (pos_ == end_) {
+            return false;
+        }
+        c = *pos_++;
+        return true;
+    }
+
+    std::string_view ParseLiteral() {
+        const char* begin = pos_;
+        while (pos_ != end_ && IsAlpha(*pos_)) {
+            ++pos_;
+        }
+        return {begin, static_cast<size_t>(pos_ - begin)};
+    }
+
+    // Элементы массивов и словарей сначала складываются в общие стеки parsed_items_
+    // и parsed_entries_, а затем переносятся в контейнер точного размера:
+    // в арене освобождённая при росте вектора память не переиспользуется
+    Node ParseArray() {
+        const size_t first = parsed_items_.size();
+        char c;
+        bool closed = false;
+        while (NextChar(c)) {
+            if (c == ']') {
+                closed = true;
+                break;
+            }
+            if (c != ',') {
+                --pos_;
+            }
+            Node item = ParseNode();
+            parsed_items_.push_back(std::move(item));
+        }
+        if (!closed) {
+            throw ParsingError("Array parsing error"s);
+        }
+        Array result(resource_);
+        result.reserve(parsed_items_.size() - first);
+        std::move(parsed_items_.begin() + first, parsed_items_.end(), std::back_inserter(result));
+        parsed_items_.resize(first);
+        return Node(std::move(result));
+    }
+
+    Node ParseDict() {
+        const size_t first = parsed_entries_.size();
+        char c;
+        bool closed = false;
+        while (NextChar(c)) {
+            if (c == '}') {
+                closed = true;
+                break;
+            }
+            if (c == '"') {
+                std::string key = ParseString();
+                if (NextChar(c) && c == ':') {
+                    Node value = ParseNode();
+                    parsed_entries_.emplace_back(std::move(key), std::move(value));
+                } else {
+                    throw ParsingError(": is expected but '"s + c + "' has been found"s);
+                }
+            } else if (c != ',') {
+                throw ParsingError(R"(',' is expected but ')"s + c + "' has been found"s);
+            }
+        }
+        if (!closed) {
+            throw ParsingError("Dictionary parsing error"s);
+        }
+        // сортируются номера элементов, а не сами пары: так каждая пара переносится один раз
+        const size_t count = parsed_entries_.size() - first;
+        order_.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            order_[i] = first + i;
+        }
+        std::sort(order_.begin(), order_.end(), [this](size_t lhs, size_t rhs) {
+            return parsed_entries_[lhs].first < parsed_entries_[rhs].first;
+        });
+        for (size_t i = 1; i < count; ++i) {
+            if (const auto& key = parsed_entries_[order_[i]].first; key == parsed_entries_[order_[i - 1]].first) {
+                throw ParsingError("Duplicate key '"s + key + "' have been found");
+            }
+        }
+        Dict dict(resource_);
+        dict.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            auto& [key, value] = parsed_entries_[order_[i]];
+            dict.emplace(std::move(key), std::move(value));
+        }
+        parsed_entries_.resize(first);
+        return Node(std::move(dict));
+    }
+
+    Node ParseSharedString() {
+        const char* begin = pos_;
+        if (const char* special = FindAnyOf<'"', '\\', '\n', '\r'>(pos_, end_); special != end_ && *special == '"') {
+            pos_ = special + 1;
+            return BufferString{{begin, static_cast<size_t>(special - begin)}};
+        }
+        return ParseString();
+    }
+
+    // Строка без escape-последовательностей - участок input, иначе она собирается в scratch_
+    std::string_view ParseStringView() {
+        const char* begin = pos_;
+        if (const char* special = FindAnyOf<'"', '\\', '\n', '\r'>(pos_, end_); special != end_ && *special == '"') {
+            pos_ = special + 1;
+            return {begin, static_cast<size_t>(special - begin)};
+        }
+        scratch_.clear();
+        ParseStringTo(scratch_);
+        return scratch_;
+    }
+
+    std::string ParseString() {
+        std::string s;
+        ParseStringTo(s);
+        return s;
+    }
+
+    // Дописывает в s содержимое строки, открывающая кавычка уже прочитана
+    void ParseStringTo(std::string& s) {
+        while (true) {
+            // Участок без специальных символов копируется целиком
+            const char* run = pos_;
+            pos_ = FindAnyOf<'"', '\\', '\n', '\r'>(pos_, end_);
+            s.append(run, pos_);
+            if (pos_ == end_) {
+                throw ParsingError("String parsing error");
+            }
+            const char ch = *pos_++;
+            if (ch == '"') {
+                break;
+            } else if (ch == '\\') {
+                if (pos_ == end_) {
+                    throw ParsingError("String parsing error");
+                }
+                const char escaped_char = *pos_++;
+                switch (escaped_char) {
+                    case 'n':
+                        s.push_back('\n');
+                        break;
+                    case 't':
+                        s.push_back('\t');
+                        break;
+                    case 'r':
+                        s.push_back('\r');
+                        break;
+                    case '"':
+                        s.push_back('"');
+                        break;
+                    case '\\':
+                        s.push_back('\\');
+                        break;
+                    default:
+                        throw ParsingError("Unrecognized escape sequence \\"s + escaped_char);
+                }
+            } else {
+                throw ParsingError("Unexpected end of line"s);
+            }
+        }
+    }
+
+    Node ParseBool() {
+        const auto s = ParseLiteral();
+        if (s == "true"sv) {
+            return Node{true};
+        } else if (s == "false"sv) {
+            return Node{false};
         } else {
-            out << ",\n"sv;
+            throw ParsingError("Failed to parse '"s + std::string(s) + "' as bool"s);
         }
-        inner_ctx.PrintIndent();
-        PrintNode(node, inner_ctx);
     }
-    out.put('\n');
-    ctx.PrintIndent();
-    out.put(']');
-}
 
-template <>
-void PrintValue<Dict>(const Dict& nodes, const PrintContext& ctx) {
-    std::ostream& out = ctx.out;
-    out << "{\n"sv;
-    bool first = true;
-    auto inner_ctx = ctx.Indented();
-    for (const auto& [key, node] : nodes) {
-        if (first) {
-            first = false;
+    Node ParseNull() {
+        if (auto literal = ParseLiteral(); literal == "null"sv) {
+            return Node{nullptr};
         } else {
-            out << ",\n"sv;
+            throw ParsingError("Failed to parse '"s + std::string(literal) + "' as null"s);
         }
-        inner_ctx.PrintIndent();
-        PrintString(key, ctx.out);
-        out << ": "sv;
-        PrintNode(node, inner_ctx);
     }
-    out.put('\n');
-    ctx.PrintIndent();
-    out.put('}');
-}
 
-void PrintNode(const Node& node, const PrintContext& ctx) {
-    std::visit(
-        [&ctx](const auto& value) {
-            PrintValue(value, ctx);
-        },
-        node.GetValue());
-}
+    Node ParseNumber() {
+        const char* begin = pos_;
+        auto read_digits = [this] {
+            if (pos_ == end_ || !IsDigit(*pos_)) {
+                throw ParsingError("A digit is expected"s);
+            }
+            while (pos_ != end_ && IsDigit(*pos_)) {
+                ++pos_;
+            }
+        };
+
+        if (pos_ != end_ && *pos_ == '-') {
+            ++pos_;
+        }
+        if (pos_ != end_ && *pos_ == '0') {
+            ++pos_;
+        } else {
+            read_digits();
+        }
+
+        bool is_int = true;
+        if (pos_ != end_ && *pos_ == '.') {
+            ++pos_;
+            read_digits();
+            is_int = false;
+        }
+
+        if (pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E')) {
+            ++pos_;
+            if (pos_ != end_ && (*pos_ == '+' || *pos_ == '-')) {
+                ++pos_;
+            }
+            read_digits();
+            is_int = false;
+        }
+
+        if (is_int) {
+            int value = 0;
+            if (const auto [ptr, ec] = std::from_chars(begin, pos_, value); ec == std::errc() && ptr == pos_) {
+                return value;
+            }
+        }
+        double value = 0.;
+        if (const auto [ptr, ec] = std::from_chars(begin, pos_, value); ec == std::errc() && ptr == pos_) {
+            return value;
+        }
+        throw ParsingError("Failed to convert "s + std::string(begin, pos_) + " to number"s);
+    }
+
+    const char* pos_;
+    const char* end_;
+    std::string_view skip_;
+    std::pmr::memory_resource* const resource_;
+    const bool share_strings_;
+    std::vector<Node> parsed_items_;
+    std::vector<Dict::value_type> parsed_entries_;
+    std::vector<size_t> order_;
+    // буфер для строк, передаваемых обработчику событий
+    std::string scratch_;
+    // ключи открытых словарей при разборе событий; ключи с escape-последовательностями
+    // копируются в escaped_keys_, остальные указывают во вход
+    std::vector<std::string_view> event_keys_;
+    std::deque<std::string> escaped_keys_;
+};
+
+// Проходит текст, различая только строки и скобки
+class StructureScanner {
+public:
+    explicit StructureScanner(std::string_view text)
+        : begin_(text.data())
+        , pos_(text.data())
+        , end_(text.data() + text.size()) {
+    }
+
+    std::optional<ArrayLayout> FindArray(std::string_view key) {
+        SkipSpaces();
+        if (!Expect('{')) {
+            return std::nullopt;
+        }
+        while (true) {
+            SkipSpaces();
+            if (!Expect('"')) {
+                return std::nullopt;
+            }
+            const char* key_begin = pos_;
+            if (!SkipString()) {
+                return std::nullopt;
+            }
+            const std::string_view current_key(key_begin, static_cast<size_t>(pos_ - 1 - key_begin));
+            SkipSpaces();
+            if (!Expect(':')) {
+                return std::nullopt;
+            }
+            SkipSpaces();
+            if (current_key == key) {
+                return pos_ != end_ && *pos_ == '[' ? ScanElements() : std::nullopt;
+            }
+            if (!SkipValue()) {
+                return std::nullopt;
+            }
+            SkipSpaces();
+            if (!Expect(',')) {
+                return std::nullopt;
+            }
+        }
+    }
+
+private:
+    std::optional<ArrayLayout> ScanElements() {
+        ArrayLayout layout;
+        layout.begin = static_cast<size_t>(pos_ - begin_);
+        ++pos_;
+        SkipSpaces();
+        if (Expect(']')) {
+            layout.end = static_cast<size_t>(pos_ - begin_);
+            return layout;
+        }
+        while (true) {
+            SkipSpaces();
+            const char* element = pos_;
+            if (!SkipValue()) {
+                return std::nullopt;
+            }
+            layout.elements.emplace_back(element, static_cast<size_t>(pos_ - element));
+            SkipSpaces();
+            if (Expect(']')) {
+                layout.end = static_cast<size_t>(pos_ - begin_);
+                return layout;
+            }
+            if (!Expect(',')) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    // Пропускает строку, открывающая кавычка уже прочитана
+    bool SkipString() {
+        while (true) {
+            pos_ = FindAnyOf<'"', '\\'>(pos_, end_);
+            if (pos_ == end_) {
+                return false;
+            }
+            if (*pos_++ == '"') {
+                return true;
+            }
+            if (pos_ == end_) {
+                return false;
+            }
+            ++pos_;
+        }
+    }
+
+    bool SkipValue() {
+        if (pos_ == end_) {
+            return false;
+        }
+        if (*pos_ == '"') {
+            ++pos_;
+            return SkipString();
+        }
+        if (*pos_ != '[' && *pos_ != '{') {
+            // число или литерал
+            const char* begin = pos_;
+            while (pos_ != end_ && *pos_ != ',' && *pos_ != ']' && *pos_ != '}' && !IsSpace(*pos_)) {
+                ++pos_;
+            }
+            return pos_ != begin;
+        }
+        size_t depth = 0;
+        while (true) {
+            pos_ = FindAnyOf<'"', '[', ']', '{', '}'>(pos_, end_);
+            if (pos_ == end_) {
+                return false;
+            }
+            const char c = *pos_++;
+            if (c == '"') {
+                if (!SkipString()) {
+                    return false;
+                }
+            } else if (c == '[' || c == '{') {
+                ++depth;
+            } else if (--depth == 0) {
+                return true;
+            }
+        }
+    }
+
+    static bool IsSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+    }
+
+    void SkipSpaces() {
+        while (pos_ != end_ && IsSpace(*pos_)) {
+            ++pos_;
+        }
+    }
+
+    bool Expect(char c) {
+        if (pos_ != end_ && *pos_ == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    const char* const begin_;
+    const char* pos_;
+    const char* const end_;
+};
 
 }  // namespace
 
@@ -328,8 +787,123 @@ Document Load(std::istream& input) {
     return Document{LoadNode(input)};
 }
 
+Document Load(std::string_view input) {
+    // Узлы занимают порядка размера текста, поэтому первый блок арены - по его размеру
+    auto arena = std::make_shared<std::pmr::monotonic_buffer_resource>(std::max<size_t>(input.size(), 1024));
+    Node root = BufferParser(input, arena.get()).ParseNode();
+    return Document{std::move(root), std::move(arena)};
+}
+
+void Parse(std::string_view input, EventHandler& handler) {
+    BufferParser(input).ParseEvents(handler);
+}
+
+Document LoadBuffer(std::string text) {
+    return LoadBuffer(std::make_shared<const std::string>(std::move(text)));
+}
+
+Document LoadBuffer(std::shared_ptr<const std::string> text, std::string_view skip) {
+    auto arena = std::make_shared<std::pmr::monotonic_buffer_resource>(std::max<size_t>(text->size() - skip.size(), 1024));
+    BufferParser parser(*text, arena.get(), true);
+    parser.Skip(skip);
+    Node root = parser.ParseNode();
+    return Document{std::move(root), std::move(arena), std::move(text)};
+}
+
+Document LoadBufferElements(std::shared_ptr<const std::string> text, const std::string_view* elements, size_t count) {
+    const size_t size = count == 0 ? 0 : static_cast<size_t>(elements[count - 1].data() + elements[count - 1].size() - elements[0].data());
+    auto arena = std::make_shared<std::pmr::monotonic_buffer_resource>(std::max<size_t>(size, 1024));
+    BufferParser parser(*text, arena.get(), true);
+    Array items(arena.get());
+    items.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        items.push_back(parser.ParsePart(elements[i]));
+    }
+    return Document{Node(std::move(items)), std::move(arena), std::move(text)};
+}
+
+Document LoadBufferAll(std::istream& input) {
+    return LoadBuffer({std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()});
+}
+
+Document LoadFile(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Failed to open '"s + path + "'"s);
+    }
+    const std::streamoff size = input.seekg(0, std::ios::end).tellg();
+    input.seekg(0);
+    if (size <= 0 || !input) {
+        input.clear();
+        return LoadBufferAll(input);
+    }
+    std::string text(static_cast<size_t>(size), '\0');
+    input.read(text.data(), size);
+    text.resize(static_cast<size_t>(input.gcount()));
+    return LoadBuffer(std::move(text));
+}
+
+std::string ReadDocumentText(std::istream& input) {
+    using Traits = std::char_traits<char>;
+    std::streambuf& buffer = *input.rdbuf();
+    std::string text;
+    int c = buffer.sgetc();
+    while (c != Traits::eof() && std::isspace(c)) {
+        c = buffer.snextc();
+    }
+    if (c == Traits::eof()) {
+        input.setstate(std::ios::eofbit);
+        return text;
+    }
+    if (c != '{' && c != '[' && c != '"') {
+        // число или литерал - до пробела
+        for (; c != Traits::eof() && !std::isspace(c); c = buffer.snextc()) {
+            text += Traits::to_char_type(c);
+        }
+        return text;
+    }
+    int depth = 0;
+    bool in_string = false;
+    bool escaped = false;
+    for (; c != Traits::eof(); c = buffer.snextc()) {
+        const char ch = Traits::to_char_type(c);
+        text += ch;
+        if (in_string) {
+            if (escaped) {
+                escaped = false;
+            } else if (ch == '\\') {
+                escaped = true;
+            } else if (ch == '"') {
+                in_string = false;
+            }
+        } else if (ch == '"') {
+            in_string = true;
+        } else if (ch == '{' || ch == '[') {
+            ++depth;
+        } else if (ch == '}' || ch == ']') {
+            --depth;
+        }
+        if (depth == 0 && !in_string) {
+            buffer.sbumpc();
+            return text;
+        }
+    }
+    // незаконченный документ - ошибку сообщит разбор
+    input.setstate(std::ios::eofbit);
+    return text;
+}
+
+std::optional<ArrayLayout> ScanArray(std::string_view text, std::string_view key) {
+    return StructureScanner(text).FindArray(key);
+}
+
 void Print(const Document& doc, std::ostream& output) {
-    PrintNode(doc.GetRoot(), PrintContext{output});
+    Print(doc, output, PrintOptions{});
+}
+
+void Print(const Document& doc, std::ostream& output, const PrintOptions& options) {
+    Writer writer(output, options);
+    writer.Value(doc.GetRoot());
 }
 
 }  // namespace json
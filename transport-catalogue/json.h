@@ -1,24 +1,95 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace json {
 
 class Node;
-using Dict = std::map<std::string, Node>;
-using Array = std::vector<Node>;
+// Память массивов и словарей берётся из memory_resource: разобранный документ
+// размещает их в своей арене, остальные узлы - в куче по умолчанию
+using Array = std::pmr::vector<Node>;
+
+// Словарь - вектор пар, отсортированный по ключу. Повторяет используемую часть
+// интерфейса std::map, обход также идёт в порядке ключей.
+// Ключи в обходе изменять нельзя, это нарушит порядок
+class Dict {
+public:
+    using value_type = std::pair<std::string, Node>;
+    using Storage = std::pmr::vector<value_type>;
+    using iterator = Storage::iterator;
+    using const_iterator = Storage::const_iterator;
+
+    Dict() = default;
+    explicit Dict(std::pmr::memory_resource* resource)
+        : items_(resource) {
+    }
+
+    iterator begin() {
+        return items_.begin();
+    }
+    iterator end() {
+        return items_.end();
+    }
+    const_iterator begin() const {
+        return items_.begin();
+    }
+    const_iterator end() const {
+        return items_.end();
+    }
+    size_t size() const {
+        return items_.size();
+    }
+    bool empty() const {
+        return items_.empty();
+    }
+    void reserve(size_t count) {
+        items_.reserve(count);
+    }
+
+    iterator find(std::string_view key);
+    const_iterator find(std::string_view key) const;
+    size_t count(std::string_view key) const;
+    Node& at(std::string_view key);
+    const Node& at(std::string_view key) const;
+    Node& operator[](std::string_view key);
+    // Как у std::map: при существующем ключе значение не меняется
+    std::pair<iterator, bool> emplace(std::string key, Node value);
+
+    bool operator==(const Dict& other) const;
+
+private:
+    const_iterator LowerBound(std::string_view key) const;
+
+    Storage items_;
+};
 
 class ParsingError : public std::runtime_error {
 public:
     using runtime_error::runtime_error;
 };
 
+// Строка без копирования: ссылается на текст документа, разобранного LoadBuffer.
+// Действительна, пока жив документ, в том числе в копиях узла
+struct BufferString {
+    std::string_view text;
+
+    bool operator==(const BufferString& other) const {
+        return text == other.text;
+    }
+};
+
 class Node final
-    : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string> {
+    : private std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string, BufferString> {
 public:
     using variant::variant;
     using Value = variant;
@@ -85,21 +156,32 @@ public:
         return std::get<Array>(*this);
     }
 
+    // Строка - и собственная, и BufferString
     bool IsString() const {
-        return std::holds_alternative<std::string>(*this);
+        return std::holds_alternative<std::string>(*this) || std::holds_alternative<BufferString>(*this);
+    }
+    // Копия строки любого вида; без копирования строку читает AsStringView
+    std::string AsString() const {
+        return std::string(AsStringView());
     }
-    const std::string& AsString() const {
+    std::string_view AsStringView() const {
         using namespace std::literals;
-        if (!IsString()) {
-            throw std::logic_error("Not a string"s);
+        if (const auto* shared = std::get_if<BufferString>(this)) {
+            return shared->text;
         }
-
-        return std::get<std::string>(*this);
+        if (const auto* owned = std::get_if<std::string>(this)) {
+            return *owned;
+        }
+        throw std::logic_error("Not a string"s);
     }
     
+    // BufferString сначала заменяется собственной копией
     std::string& MutableString() {
         using namespace std::literals;
-        if (!IsString()) {
+        if (const auto* shared = std::get_if<BufferString>(this)) {
+            *this = std::string(shared->text);
+        }
+        if (!std::holds_alternative<std::string>(*this)) {
             throw std::logic_error("Not a string"s);
         }
 
@@ -126,7 +208,11 @@ public:
         return std::get<Dict>(*this);
     }
 
+    // Строки равны по содержимому независимо от способа хранения
     bool operator==(const Node& rhs) const {
+        if (IsString() && rhs.IsString()) {
+            return AsStringView() == rhs.AsStringView();
+        }
         return GetValue() == rhs.GetValue();
     }
 
@@ -143,17 +229,87 @@ inline bool operator!=(const Node& lhs, const Node& rhs) {
     return !(lhs == rhs);
 }
 
+inline bool Dict::operator==(const Dict& other) const {
+    return items_ == other.items_;
+}
+
+inline Dict::const_iterator Dict::LowerBound(std::string_view key) const {
+    return std::lower_bound(items_.begin(), items_.end(), key, [](const value_type& item, std::string_view probe) {
+        return std::string_view(item.first) < probe;
+    });
+}
+
+inline Dict::const_iterator Dict::find(std::string_view key) const {
+    const auto it = LowerBound(key);
+    return it != items_.end() && it->first == key ? it : items_.end();
+}
+
+inline Dict::iterator Dict::find(std::string_view key) {
+    return items_.begin() + (std::as_const(*this).find(key) - items_.cbegin());
+}
+
+inline size_t Dict::count(std::string_view key) const {
+    return find(key) == end() ? 0 : 1;
+}
+
+inline const Node& Dict::at(std::string_view key) const {
+    using namespace std::literals;
+    const auto it = find(key);
+    if (it == end()) {
+        throw std::out_of_range("No key '"s + std::string(key) + "' in dict"s);
+    }
+    return it->second;
+}
+
+inline Node& Dict::at(std::string_view key) {
+    return const_cast<Node&>(std::as_const(*this).at(key));
+}
+
+inline std::pair<Dict::iterator, bool> Dict::emplace(std::string key, Node value) {
+    // JSON обычно записан с упорядоченными ключами, тогда вставка идёт в конец
+    if (items_.empty() || items_.back().first < key) {
+        items_.emplace_back(std::move(key), std::move(value));
+        return {items_.end() - 1, true};
+    }
+    const auto pos = items_.begin() + (LowerBound(key) - items_.cbegin());
+    if (pos != items_.end() && pos->first == key) {
+        return {pos, false};
+    }
+    return {items_.emplace(pos, std::move(key), std::move(value)), true};
+}
+
+inline Node& Dict::operator[](std::string_view key) {
+    return emplace(std::string(key), Node()).first->second;
+}
+
+// Документ владеет ареной, из которой размещены его массивы и словари, и текстом,
+// на который ссылаются его BufferString. Копии узлов документа берут память из кучи
+// и от арены не зависят
 class Document {
 public:
     explicit Document(Node root)
         : root_(std::move(root)) {
     }
 
+    Document(Node root, std::shared_ptr<std::pmr::memory_resource> arena, std::shared_ptr<const std::string> text = nullptr)
+        : text_(std::move(text))
+        , arena_(std::move(arena))
+        , root_(std::move(root)) {
+    }
+
     const Node& GetRoot() const {
         return root_;
     }
 
+    // Текст, на который ссылаются BufferString, или nullptr
+    const std::shared_ptr<const std::string>& GetText() const {
+        return text_;
+    }
+
 private:
+    // объявлены до root_, чтобы разрушаться после него
+    std::shared_ptr<const std::string> text_;
+    std::shared_ptr<std::pmr::memory_resource> arena_;
     Node root_;
 };
 
@@ -167,6 +323,78 @@ inline bool operator!=(const Document& lhs, const Document& rhs) {
 
 Document Load(std::istream& input);
 
+// Разбор из непрерывного буфера, результат совпадает с Load(std::istream&)
+Document Load(std::string_view input);
+// Разбирает text, который переходит во владение документа. Строки без
+// escape-последовательностей не копируются, а хранятся как BufferString
+Document LoadBuffer(std::string text);
+// Разбирает общий text, как LoadBuffer(std::string). Значение, начинающееся в
+// skip.data(), не разбирается: на его место встаёт пустой массив, а разбор
+// продолжается после skip. Так разбирается документ без массива из ScanArray
+Document LoadBuffer(std::shared_ptr<const std::string> text, std::string_view skip = {});
+// Разбирает count участков elements текста text (например, элементов из ScanArray)
+// как элементы одного массива - корня документа. Все значения размещаются
+// в одной арене, строки без escape-последовательностей - BufferString в text
+Document LoadBufferElements(std::shared_ptr<const std::string> text, const std::string_view* elements, size_t count);
+// Читает поток целиком и разбирает его как LoadBuffer
+Document LoadBufferAll(std::istream& input);
+// Читает файл path одним вызовом read и разбирает его как LoadBuffer.
+// Если размер файла узнать нельзя (канал, устройство), файл читается как поток.
+// Файл, который не удалось открыть, - std::runtime_error
+Document LoadFile(const std::string& path);
+// Текст одного значения JSON из input, без разбора. Поток читается до конца значения
+// и не дальше, как при Load(std::istream&), поэтому после документа в нём могут идти
+// другие данные. Синтаксис проверит разбор текста
+std::string ReadDocumentText(std::istream& input);
+
+// Обработчик событий потокового (SAX) разбора. Строки и ключи передаются
+// как string_view, действительные только на время вызова
+class EventHandler {
+public:
+    virtual void StartDict() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void EndDict() = 0;
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+    virtual void Null() = 0;
+    virtual void Bool(bool value) = 0;
+    virtual void Int(int value) = 0;
+    virtual void Double(double value) = 0;
+    virtual void String(std::string_view value) = 0;
+
+    virtual ~EventHandler() = default;
+};
+
+// Разбирает input, сообщая handler о каждом значении, без построения Document.
+// Строки и ключи без escape-последовательностей указывают прямо в input.
+// Повторяющийся ключ словаря - ошибка, как в Load; о ней сообщается после событий
+// всех элементов словаря
+void Parse(std::string_view input, EventHandler& handler);
+
+// Оформление вывода
+struct PrintOptions {
+    // без пробелов и переводов строк, например для построчного (NDJSON) вывода
+    bool compact = false;
+    // double в кратчайшей записи, которая читается обратно без потерь;
+    // по умолчанию - 6 значащих цифр, как у operator<<
+    bool round_trip_doubles = false;
+};
+
+// Участки текста элементов массива из словаря верхнего уровня
+struct ArrayLayout {
+    // позиция '[' и позиция после ']'
+    size_t begin = 0;
+    size_t end = 0;
+    std::vector<std::string_view> elements;
+};
+
+// Быстрый структурный просмотр text: находит массив по ключу key словаря верхнего
+// уровня и границы его элементов, не строя значений. Синтаксис элементов
+// не проверяется, это сделает их разбор. nullopt, если такого массива нет
+// или структура вокруг него нарушена
+std::optional<ArrayLayout> ScanArray(std::string_view text, std::string_view key);
+
 void Print(const Document& doc, std::ostream& output);
+void Print(const Document& doc, std::ostream& output, const PrintOptions& options);
 
 }  // namespace json
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "json.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace json {
+
+    // Поле объекта JSON: ключ и запись значения в объект типа T
+    template <typename T>
+    struct Field {
+        std::string_view key;
+        void (*read)(T& object, const Node& value);
+        bool required = false;
+    };
+
+    // Таблица полей должна быть упорядочена по ключам, как json::Dict
+    template <typename T, size_t N>
+    constexpr bool AreKeysSorted(const std::array<Field<T>, N>& fields) {
+        return std::is_sorted(fields.begin(), fields.end(), [](const Field<T>& lhs, const Field<T>& rhs) {
+            return lhs.key < rhs.key;
+        });
+    }
+
+    // Заполняет object из dict за один проход: ключи словаря и таблицы fields
+    // упорядочены, поэтому поля находятся слиянием, без поиска и временных строк.
+    // Незнакомые ключи пропускаются; для отсутствующего обязательного поля
+    // бросается std::out_of_range, как у Dict::at
+    template <typename T, size_t N>
+    void Decode(const Dict& dict, const std::array<Field<T>, N>& fields, T& object) {
+        using namespace std::literals;
+        auto check_missing = [](const Field<T>& field) {
+            if (field.required) {
+                throw std::out_of_range("No key '"s + std::string(field.key) + "' in dict"s);
+            }
+        };
+        size_t index = 0;
+        for (const auto& [key, value] : dict) {
+            for (; index < N && fields[index].key < key; ++index) {
+                check_missing(fields[index]);
+            }
+            if (index == N) {
+                return;
+            }
+            if (fields[index].key == key) {
+                fields[index].read(object, value);
+                ++index;
+            }
+        }
+        for (; index < N; ++index) {
+            check_missing(fields[index]);
+        }
+    }
+
+}
@@ -1,134 +1,23 @@
 #include "json_reader.h"
 #include "json.h"
+#include "json_builder.h"
+#include "json_decoder.h"
 #include "map_renderer.h"
+#include "parallel.h"
 
 #include <algorithm>
+#include <array>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <optional>
 #include <sstream>
+#include <stdexcept>
 
 using namespace json;
 using namespace domain;
 using namespace std::literals;
 
-void JsonReader::ParseBaseRequest(const json::Dict& root) {
-    for (auto ptr = root.find("base_requests"); ptr != root.end(); ptr = root.end()) {
-        const auto& requests = ptr->second.AsArray();
-        for (const auto& r : requests) {
-            const auto& base_request = r.AsDict();
-            std::string type = base_request.at("type").AsString();
-            std::string name = base_request.at("name").AsString();
-            if (type == "Stop") {
-                StopRequest ans;
-                ans.name = name;
-                ans.place = {base_request.at("latitude").AsDouble(), base_request.at("longitude").AsDouble()};
-                if (base_request.count("road_distances")) {
-                    for (const auto& [id, dist] : base_request.at("road_distances").AsDict()) {
-                        ans.road_distances.push_back({id, dist.AsInt()});
-                    }
-                }
-                commands_.stop_requests.push_back(ans);
-            } else if (type == "Bus") {
-                BusRequest ans;
-                ans.name = name;
-                const auto& stops = base_request.at("stops").AsArray();          
-                for (const auto& stop : stops) {
-                    ans.stops.push_back(commands_.AddId(stop.AsString()));
-                }
-                ans.is_roundtrip = base_request.at("is_roundtrip").AsBool();
-                ans.final_stops.push_back(ans.stops.front());
-                if (!ans.is_roundtrip) {
-                    if (ans.stops.front() != ans.stops.back()) {
-                        ans.final_stops.push_back(ans.stops.back());
-                    }
-                    std::vector<std::string_view> return_stops;
-                    for (auto it = ans.stops.rbegin(); it != ans.stops.rend();++it) {
-                        if (it == ans.stops.rbegin()) {
-                            continue;
-                        }
-                        return_stops.push_back(*it);
-                    }
-                    for (const auto& s : return_stops) {
-                        ans.stops.push_back(s);
-                    }
-                }
-                commands_.bus_requests.push_back(ans);
-            }
-        }
-    } 
-}
-
-void JsonReader::ParseStatRequest(const json::Dict& root) {
-    for (auto ptr = root.find("stat_requests"); ptr != root.end(); ptr = root.end()) {
-        const auto& requests = ptr->second.AsArray();
-        for (const auto& req : requests) {
-            StatRequest ans;
-            const auto& r = req.AsDict();
-            ans.id = GetValueOrDefault<int>(r, "id");
-            std::string type = GetValueOrDefault<std::string>(r, "type");
-            if (type == "Bus") {
-                ans.type = StatType::Bus;
-                ans.name = GetValueOrDefault<std::string>(r, "name");
-            } else if (type == "Stop") {
-                ans.type = StatType::Stop;
-                ans.name = GetValueOrDefault<std::string>(r, "name");
-            } else if (type == "Map") {
-                ans.type = StatType::Map;
-            } else if (type == "Route") {
-                ans.type = StatType::Route;
-                ans.from = GetValueOrDefault<std::string>(r, "from");
-                ans.to = GetValueOrDefault<std::string>(r, "to");
-            }
-            commands_.stat_requests.push_back(ans);
-        }
-    }
-}
-
-void JsonReader::ParseBaseSettings(const json::Dict& root) {    
-    for (auto ptr = root.find("routing_settings"); ptr != root.end(); ptr = root.end()) {
-        const auto& s = ptr->second.AsDict();
-        base_settings_.bus_wait_time = std::move(GetValueOrDefault<int>(s, "bus_wait_time"));
-        base_settings_.bus_velocity = std::move(GetValueOrDefault<int>(s, "bus_velocity"));
-    }
-}
-
-void JsonReader::ParseSettings(const json::Dict& root) {    
-    for (auto ptr = root.find("render_settings"); ptr != root.end(); ptr = root.end()) {
-        const auto& s = ptr->second.AsDict();
-        settings_.width = std::move(GetValueOrDefault<double>(s, "width"));
-        settings_.height = std::move(GetValueOrDefault<double>(s, "height"));
-        settings_.padding = std::move(GetValueOrDefault<double>(s, "padding"));
-        settings_.line_width = std::move(GetValueOrDefault<double>(s, "line_width"));
-        settings_.stop_radius = std::move(GetValueOrDefault<double>(s, "stop_radius"));
-        settings_.bus_label_font_size = std::move(GetValueOrDefault<double>(s, "bus_label_font_size"));
-        settings_.bus_label_offset = std::move(GetValueOrDefault<svg::Point>(s, "bus_label_offset"));
-        settings_.stop_label_font_size = std::move(GetValueOrDefault<int>(s, "stop_label_font_size"));
-        settings_.stop_label_offset = std::move(GetValueOrDefault<svg::Point>(s, "stop_label_offset"));
-        settings_.underlayer_color = std::move(GetValueOrDefault<svg::Color>(s, "underlayer_color"));
-        settings_.underlayer_width = std::move(GetValueOrDefault<double>(s, "underlayer_width"));
-        settings_.color_palette = std::move(GetValueOrDefault<ColorPalette>(s, "color_palette"));
-    }
-}
-
-void JsonReader::ParseCommands(std::istream& in) {
-    Document doc = json::Load(in);
-    const auto& root = doc.GetRoot().AsDict();
-    ParseBaseRequest(root);
-    ParseStatRequest(root);
-    ParseSettings(root);
-    ParseBaseSettings(root);
-}
-
-const RenderSettings& JsonReader::GetSettings() const {
-    return settings_;
-}
-
-const RoutingSettings& JsonReader::GetBaseSettings() const {
-    return base_settings_;
-}
-
-const Commands& JsonReader::GetCommands() const {
-    return commands_;
-}
-
 template <>
 svg::Color JsonReader::Default() {
     return svg::DefaultColor;
@@ -174,7 +63,7 @@ svg::Point JsonReader::CastNode(const json::Node& node) {
 template <>
 svg::Color JsonReader::CastNode(const json::Node& node) {
     if (node.IsString()) {
-        return svg::Color(node.AsString());
+        return svg::Color(node.AsStringView());
     } else if (node.IsArray()) {
         const auto& components = node.AsArray();
         std::stringstream ss;        
@@ -201,3 +90,612 @@ ColorPalette JsonReader::CastNode(const json::Node& node) {
     }
     return Default<ColorPalette>();
 }
+
+void JsonReader::ParseBaseRequest(const json::Dict& root) {
+    for (auto ptr = root.find("base_requests"); ptr != root.end(); ptr = root.end()) {
+        const auto& requests = ptr->second.AsArray();
+        for (const auto& r : requests) {
+            AddBaseRequest(r.AsDict());
+        }
+    } 
+}
+
+void JsonReader::AddBaseRequest(const json::Dict& base_request) {
+    // Ключи таблиц упорядочены, см. json::Decode
+    static constexpr std::array<json::Field<StopRequest>, 4> stop_fields {{
+        {"latitude"sv, [](StopRequest& r, const Node& n) { r.place.lat = n.AsDouble(); }, true},
+        {"longitude"sv, [](StopRequest& r, const Node& n) { r.place.lng = n.AsDouble(); }, true},
+        {"name"sv, [](StopRequest& r, const Node& n) { r.name = n.AsStringView(); }, true},
+        {"road_distances"sv, [](StopRequest& r, const Node& n) {
+            const auto& distances = n.AsDict();
+            r.road_distances.reserve(distances.size());
+            for (const auto& [id, dist] : distances) {
+                r.road_distances.push_back({id, dist.AsInt()});
+            }
+        }},
+    }};
+    // Имена сначала ссылаются на строки узлов и заменяются на общие после разбора
+    static constexpr std::array<json::Field<BusRequest>, 3> bus_fields {{
+        {"is_roundtrip"sv, [](BusRequest& r, const Node& n) { r.is_roundtrip = n.AsBool(); }, true},
+        {"name"sv, [](BusRequest& r, const Node& n) { r.name = n.AsStringView(); }, true},
+        {"stops"sv, [](BusRequest& r, const Node& n) {
+            const auto& stops = n.AsArray();
+            r.stops.reserve(stops.size());
+            for (const auto& stop : stops) {
+                r.stops.push_back(stop.AsStringView());
+            }
+        }, true},
+    }};
+    static_assert(json::AreKeysSorted(stop_fields) && json::AreKeysSorted(bus_fields));
+
+    const std::string_view type = base_request.at("type"sv).AsStringView();
+    if (type == "Stop"sv) {
+        StopRequest ans;
+        json::Decode(base_request, stop_fields, ans);
+        ans.name = commands_.AddId(ans.name);
+        for (auto& distance : ans.road_distances) {
+            distance.stop = commands_.AddId(distance.stop);
+        }
+        commands_.stop_requests.push_back(std::move(ans));
+    } else if (type == "Bus"sv) {
+        BusRequest ans;
+        json::Decode(base_request, bus_fields, ans);
+        ans.name = commands_.AddId(ans.name);
+        for (auto& stop : ans.stops) {
+            stop = commands_.AddId(stop);
+        }
+        AddBusRequest(std::move(ans));
+    }
+}
+
+void JsonReader::AddBusRequest(BusRequest ans) {
+    ans.final_stops.push_back(ans.stops.front());
+    if (!ans.is_roundtrip) {
+        if (ans.stops.front() != ans.stops.back()) {
+            ans.final_stops.push_back(ans.stops.back());
+        }
+        std::vector<std::string_view> return_stops;
+        for (auto it = ans.stops.rbegin(); it != ans.stops.rend();++it) {
+            if (it == ans.stops.rbegin()) {
+                continue;
+            }
+            return_stops.push_back(*it);
+        }
+        for (const auto& s : return_stops) {
+            ans.stops.push_back(s);
+        }
+    }
+    commands_.bus_requests.push_back(std::move(ans));
+}
+
+void JsonReader::ParseStatRequest(const json::Dict& root) {
+    for (auto ptr = root.find("stat_requests"); ptr != root.end(); ptr = root.end()) {
+        const auto& requests = ptr->second.AsArray();
+        for (const auto& req : requests) {
+            AddStatRequest(req.AsDict());
+        }
+    }
+}
+
+void JsonReader::AddStatRequest(const json::Dict& r) {
+    commands_.stat_requests.push_back(ReadStatRequest(r));
+}
+
+StatRequest JsonReader::ReadStatRequest(const json::Dict& r) {
+    static constexpr std::array<json::Field<StatRequest>, 12> fields {{
+        {"count"sv, [](StatRequest& s, const Node& n) { s.count = CastNode<int>(n); }},
+        {"from"sv, [](StatRequest& s, const Node& n) { s.from = n.AsStringView(); }},
+        {"id"sv, [](StatRequest& s, const Node& n) { s.id = CastNode<int>(n); }},
+        {"latitude"sv, [](StatRequest& s, const Node& n) { s.place.lat = CastNode<double>(n); }},
+        {"longitude"sv, [](StatRequest& s, const Node& n) { s.place.lng = CastNode<double>(n); }},
+        {"name"sv, [](StatRequest& s, const Node& n) { s.name = n.AsStringView(); }},
+        {"radius"sv, [](StatRequest& s, const Node& n) { s.radius = CastNode<double>(n); }},
+        {"to"sv, [](StatRequest& s, const Node& n) { s.to = n.AsStringView(); }},
+        {"type"sv, [](StatRequest& s, const Node& n) {
+            const std::string_view type = n.AsStringView();
+            if (type == "Bus"sv) {
+                s.type = StatType::Bus;
+            } else if (type == "Stop"sv) {
+                s.type = StatType::Stop;
+            } else if (type == "Map"sv) {
+                s.type = StatType::Map;
+            } else if (type == "Route"sv) {
+                s.type = StatType::Route;
+            } else if (type == "NearestStops"sv) {
+                s.type = StatType::NearestStops;
+            } else if (type == "MapTile"sv) {
+                s.type = StatType::MapTile;
+            } else if (type == "RouteMap"sv) {
+                s.type = StatType::RouteMap;
+            }
+        }},
+        {"x"sv, [](StatRequest& s, const Node& n) { s.x = CastNode<int>(n); }},
+        {"y"sv, [](StatRequest& s, const Node& n) { s.y = CastNode<int>(n); }},
+        {"zoom"sv, [](StatRequest& s, const Node& n) { s.zoom = CastNode<int>(n); }},
+    }};
+    static_assert(json::AreKeysSorted(fields));
+
+    StatRequest ans;
+    ans.id = Default<int>();
+    json::Decode(r, fields, ans);
+    return ans;
+}
+
+void JsonReader::ParseBaseSettings(const json::Dict& root) {    
+    static constexpr std::array<json::Field<RoutingSettings>, 2> fields {{
+        {"bus_velocity"sv, [](RoutingSettings& s, const Node& n) { s.bus_velocity = CastNode<int>(n); }},
+        {"bus_wait_time"sv, [](RoutingSettings& s, const Node& n) { s.bus_wait_time = CastNode<int>(n); }},
+    }};
+    static_assert(json::AreKeysSorted(fields));
+
+    for (auto ptr = root.find("routing_settings"sv); ptr != root.end(); ptr = root.end()) {
+        base_settings_ = {Default<int>(), Default<int>()};
+        json::Decode(ptr->second.AsDict(), fields, base_settings_);
+    }
+}
+
+void JsonReader::ParseSettings(const json::Dict& root) {    
+    static constexpr std::array<json::Field<RenderSettings>, 14> fields {{
+        {"bus_label_font_size"sv, [](RenderSettings& s, const Node& n) { s.bus_label_font_size = CastNode<double>(n); }},
+        {"bus_label_offset"sv, [](RenderSettings& s, const Node& n) { s.bus_label_offset = CastNode<svg::Point>(n); }},
+        {"color_palette"sv, [](RenderSettings& s, const Node& n) { s.color_palette = CastNode<ColorPalette>(n); }},
+        {"height"sv, [](RenderSettings& s, const Node& n) { s.height = CastNode<double>(n); }},
+        {"line_width"sv, [](RenderSettings& s, const Node& n) { s.line_width = CastNode<double>(n); }},
+        {"padding"sv, [](RenderSettings& s, const Node& n) { s.padding = CastNode<double>(n); }},
+        {"simplify_tolerance"sv, [](RenderSettings& s, const Node& n) { s.simplify_tolerance = CastNode<double>(n); }},
+        {"stop_label_font_size"sv, [](RenderSettings& s, const Node& n) { s.stop_label_font_size = CastNode<int>(n); }},
+        {"stop_label_offset"sv, [](RenderSettings& s, const Node& n) { s.stop_label_offset = CastNode<svg::Point>(n); }},
+        {"stop_radius"sv, [](RenderSettings& s, const Node& n) { s.stop_radius = CastNode<double>(n); }},
+        {"style_classes"sv, [](RenderSettings& s, const Node& n) { s.style_classes = n.AsBool(); }},
+        {"underlayer_color"sv, [](RenderSettings& s, const Node& n) { s.underlayer_color = CastNode<svg::Color>(n); }},
+        {"underlayer_width"sv, [](RenderSettings& s, const Node& n) { s.underlayer_width = CastNode<double>(n); }},
+        {"width"sv, [](RenderSettings& s, const Node& n) { s.width = CastNode<double>(n); }},
+    }};
+    static_assert(json::AreKeysSorted(fields));
+
+    for (auto ptr = root.find("render_settings"sv); ptr != root.end(); ptr = root.end()) {
+        // отсутствующие поля получают значения Default<T>()
+        settings_ = RenderSettings{};
+        settings_.bus_label_offset = Default<svg::Point>();
+        settings_.stop_label_offset = Default<svg::Point>();
+        settings_.underlayer_color = Default<svg::Color>();
+        json::Decode(ptr->second.AsDict(), fields, settings_);
+    }
+}
+
+void JsonReader::ParseCommands(std::istream& in) {
+    ParseCommands(json::LoadBufferAll(in));
+}
+
+void JsonReader::ParseCommandsParallel(std::istream& in, size_t threads) {
+    const auto buffer = std::make_shared<const std::string>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    const auto layout = json::ScanArray(*buffer, "base_requests"sv);
+    if (!layout || layout->elements.empty()) {
+        // ошибки структуры сообщит обычный разбор
+        ParseCommands(json::LoadBuffer(buffer));
+        return;
+    }
+    const auto& elements = layout->elements;
+    // Каждый отрезок элементов разбирается в одну арену и в свой JsonReader,
+    // затем команды переносятся сюда в порядке отрезков
+    const size_t parts_count = std::clamp<size_t>(threads, 1, elements.size());
+    const size_t step = (elements.size() + parts_count - 1) / parts_count;
+    std::vector<JsonReader> parts((elements.size() + step - 1) / step);
+    parallel::ForEachRange(parts.size(), parts.size(), [&buffer, &elements, &parts, step](size_t begin, size_t end) {
+        for (size_t part = begin; part < end; ++part) {
+            const size_t first = part * step;
+            const size_t last = std::min(elements.size(), first + step);
+            const json::Document doc = json::LoadBufferElements(buffer, elements.data() + first, last - first);
+            parts[part].commands_.KeepText(buffer);
+            for (const auto& element : doc.GetRoot().AsArray()) {
+                parts[part].AddBaseRequest(element.AsDict());
+            }
+        }
+    });
+    for (auto& part : parts) {
+        commands_.Append(std::move(part.commands_));
+    }
+    // Остаток документа - без уже разобранного base_requests
+    ParseCommands(json::LoadBuffer(buffer, std::string_view(*buffer).substr(layout->begin, layout->end - layout->begin)));
+}
+
+void JsonReader::ParseCommands(const json::Document& doc) {
+    // имена команд могут ссылаться прямо в текст документа
+    commands_.KeepText(doc.GetText());
+    const auto& root = doc.GetRoot().AsDict();
+    ParseBaseRequest(root);
+    ParseStatRequest(root);
+    ParseSettings(root);
+    ParseBaseSettings(root);
+}
+
+// Заполняет команды по событиям разбора. Элементы base_requests разбираются
+// прямо в StopRequest/BusRequest; элементы stat_requests и настройки невелики,
+// поэтому каждый из них собирается в отдельный Node через json::Builder
+// и разбирается теми же функциями, что и в ParseCommands.
+class JsonReader::EventReader final : public json::EventHandler {
+public:
+    explicit EventReader(JsonReader& reader) : reader_(reader) {
+    }
+
+    void StartDict() override {
+        if (subtree_) {
+            ++subtree_depth_;
+            if (!discard_) {
+                subtree_->StartDict();
+            }
+            return;
+        }
+        const bool expected = Expect(Kind::Dict);
+        if (depth_ == 0) {
+            depth_ = 1;
+        } else if (depth_ == 2 && section_ == Section::BaseRequests) {
+            depth_ = 3;
+            stop_ = {};
+            bus_ = {};
+            type_.clear();
+            seen_keys_ = 0;
+            bad_keys_ = 0;
+        } else if (depth_ == 3 && expected) {
+            // road_distances
+            depth_ = 4;
+        } else {
+            StartSubtree(depth_ > 2 || section_ == Section::BaseRequests);
+            ++subtree_depth_;
+            if (!discard_) {
+                subtree_->StartDict();
+            }
+        }
+    }
+
+    void Key(std::string_view key) override {
+        if (subtree_) {
+            if (!discard_) {
+                subtree_->Key(std::string(key));
+            }
+        } else if (depth_ == 1) {
+            section_name_ = key;
+            section_ = key == "base_requests"sv ? Section::BaseRequests
+                     : key == "stat_requests"sv ? Section::StatRequests
+                     : Section::Other;
+        } else if (depth_ == 3) {
+            const auto it = std::find_if(FIELDS.begin(), FIELDS.end(), [key](const Field& field) {
+                return field.key == key;
+            });
+            field_ = it != FIELDS.end() ? &*it : nullptr;
+            if (field_) {
+                seen_keys_ |= KeyBit(key);
+            }
+        } else if (depth_ == 4) {
+            distance_to_ = reader_.commands_.AddId(key);
+        }
+    }
+
+    void EndDict() override {
+        if (subtree_) {
+            --subtree_depth_;
+            if (!discard_) {
+                subtree_->EndDict();
+            }
+            CompleteSubtree();
+        } else if (depth_ == 4) {
+            depth_ = 3;
+        } else if (depth_ == 3) {
+            depth_ = 2;
+            AddBaseRequest();
+        } else {
+            depth_ = 0;
+        }
+    }
+
+    void StartArray() override {
+        if (subtree_) {
+            ++subtree_depth_;
+            if (!discard_) {
+                subtree_->StartArray();
+            }
+            return;
+        }
+        const bool expected = Expect(Kind::Array);
+        if (depth_ == 1 && section_ != Section::Other) {
+            depth_ = 2;
+        } else if (depth_ == 3 && expected) {
+            // stops
+            depth_ = 4;
+        } else {
+            StartSubtree(depth_ > 2 || section_ == Section::BaseRequests);
+            ++subtree_depth_;
+            if (!discard_) {
+                subtree_->StartArray();
+            }
+        }
+    }
+
+    void EndArray() override {
+        if (subtree_) {
+            --subtree_depth_;
+            if (!discard_) {
+                subtree_->EndArray();
+            }
+            CompleteSubtree();
+        } else if (depth_ == 4) {
+            depth_ = 3;
+        } else {
+            depth_ = 1;
+        }
+    }
+
+    void Null() override {
+        if (!subtree_ && depth_ > 2) {
+            Expect(Kind::Null);
+            return;
+        }
+        Value(nullptr, Kind::Null);
+    }
+
+    void Bool(bool value) override {
+        if (!subtree_ && depth_ > 2) {
+            // is_roundtrip
+            if (Expect(Kind::Bool)) {
+                bus_.is_roundtrip = value;
+            }
+            return;
+        }
+        Value(value, Kind::Bool);
+    }
+
+    void Int(int value) override {
+        if (!subtree_ && depth_ > 2) {
+            if (!Expect(Kind::Int)) {
+                return;
+            }
+            if (depth_ == 4) {
+                stop_.road_distances.push_back({distance_to_, value});
+            } else {
+                SetCoordinate(value);
+            }
+            return;
+        }
+        Value(value, Kind::Int);
+    }
+
+    void Double(double value) override {
+        if (!subtree_ && depth_ > 2) {
+            if (Expect(Kind::Double)) {
+                SetCoordinate(value);
+            }
+            return;
+        }
+        Value(value, Kind::Double);
+    }
+
+    void String(std::string_view value) override {
+        if (!subtree_ && depth_ > 2) {
+            if (!Expect(Kind::String)) {
+                return;
+            }
+            if (depth_ == 4) {
+                bus_.stops.push_back(reader_.commands_.AddId(value));
+            } else if (field_->key == "type"sv) {
+                type_ = value;
+            } else {
+                stop_.name = reader_.commands_.AddId(value);
+            }
+            return;
+        }
+        Value(std::string(value), Kind::String);
+    }
+
+    // Разбирает собранные настройки, вызывается после окончания разбора
+    void Finish() {
+        reader_.ParseSettings(rest_);
+        reader_.ParseBaseSettings(rest_);
+    }
+
+private:
+    enum class Section {
+        BaseRequests,
+        StatRequests,
+        Other
+    };
+
+    enum class Kind {
+        Null,
+        Bool,
+        Int,
+        Double,
+        String,
+        Array,
+        Dict
+    };
+
+    // Поле элемента base_requests, которое разбирает AddBaseRequest(const json::Dict&),
+    // тип его значения и, для road_distances и stops, тип их элементов
+    struct Field {
+        std::string_view key;
+        Kind kind;
+        Kind item_kind;
+    };
+
+    static constexpr std::array<Field, 7> FIELDS {{
+        {"is_roundtrip"sv, Kind::Bool, Kind::Null},
+        {"latitude"sv, Kind::Double, Kind::Null},
+        {"longitude"sv, Kind::Double, Kind::Null},
+        {"name"sv, Kind::String, Kind::Null},
+        {"road_distances"sv, Kind::Dict, Kind::Int},
+        {"stops"sv, Kind::Array, Kind::String},
+        {"type"sv, Kind::String, Kind::Null},
+    }};
+
+    void StartSubtree(bool discard) {
+        subtree_.emplace();
+        subtree_depth_ = 0;
+        discard_ = discard;
+    }
+
+    void Value(json::Node::Value value, Kind kind) {
+        if (subtree_) {
+            if (!discard_) {
+                subtree_->Value(std::move(value));
+            }
+            return;
+        }
+        Expect(kind);
+        if (depth_ == 1 || (depth_ == 2 && section_ == Section::StatRequests)) {
+            // одиночное значение не требует Builder, который к тому же не строит null
+            json::Node node;
+            node.MutableValue() = std::move(value);
+            AddNode(std::move(node));
+        }
+    }
+
+    void CompleteSubtree() {
+        if (subtree_depth_ > 0) {
+            return;
+        }
+        if (!discard_) {
+            AddNode(subtree_->Build());
+        }
+        subtree_.reset();
+    }
+
+    // Значение корневого словаря или элемент stat_requests
+    void AddNode(json::Node node) {
+        if (depth_ == 1) {
+            rest_[section_name_] = std::move(node);
+        } else {
+            reader_.AddStatRequest(node.AsDict());
+        }
+    }
+
+    // Проверяет тип значения вне поддерева так же, как его проверил бы разбор
+    // через Document. Корень, массивы запросов и элементы base_requests другого типа -
+    // сразу ошибка. Значение другого типа у поля элемента base_requests запоминается
+    // и становится ошибкой в AddBaseRequest, если поле нужно типу элемента.
+    // true - значение того типа, который ждёт разбор
+    bool Expect(Kind kind) {
+        switch (depth_) {
+            case 0:
+                if (kind != Kind::Dict) {
+                    throw json::ParsingError("Root is not a dict"s);
+                }
+                return true;
+            case 1:
+                if (section_ != Section::Other && kind != Kind::Array) {
+                    throw json::ParsingError("'"s + section_name_ + "' is not an array"s);
+                }
+                return true;
+            case 2:
+                if (section_ == Section::BaseRequests && kind != Kind::Dict) {
+                    throw json::ParsingError("Element of 'base_requests' is not a dict"s);
+                }
+                return true;
+            case 3:
+                return field_ && Matches(field_->kind, kind);
+            default:
+                return Matches(field_->item_kind, kind);
+        }
+    }
+
+    bool Matches(Kind expected, Kind kind) {
+        // как у Node::AsDouble, целое годится и как double
+        if (expected == kind || (expected == Kind::Double && kind == Kind::Int)) {
+            return true;
+        }
+        bad_keys_ |= KeyBit(field_->key);
+        return false;
+    }
+
+    void SetCoordinate(double value) {
+        if (field_->key == "latitude"sv) {
+            stop_.place.lat = value;
+        } else {
+            stop_.place.lng = value;
+        }
+    }
+
+    static unsigned KeyBit(std::string_view key) {
+        const auto it = std::find_if(FIELDS.begin(), FIELDS.end(), [key](const Field& field) {
+            return field.key == key;
+        });
+        return 1u << (it - FIELDS.begin());
+    }
+
+    // Бросает то же исключение, что json::Decode и Dict::at, для первого отсутствующего ключа
+    void RequireKeys(std::initializer_list<std::string_view> keys) const {
+        for (const auto key : keys) {
+            if ((seen_keys_ & KeyBit(key)) == 0) {
+                throw std::out_of_range("No key '"s + std::string(key) + "' in dict"s);
+            }
+        }
+    }
+
+    void RequireTypes(std::initializer_list<std::string_view> keys) const {
+        for (const auto key : keys) {
+            if ((bad_keys_ & KeyBit(key)) != 0) {
+                throw json::ParsingError("Wrong type of '"s + std::string(key) + "' in base request"s);
+            }
+        }
+    }
+
+    // Ключи проверяются в порядке таблиц AddBaseRequest(const json::Dict&)
+    void AddBaseRequest() {
+        RequireKeys({"type"sv});
+        RequireTypes({"type"sv});
+        if (type_ == "Stop"sv) {
+            RequireKeys({"latitude"sv, "longitude"sv, "name"sv});
+            RequireTypes({"latitude"sv, "longitude"sv, "name"sv, "road_distances"sv});
+            reader_.commands_.stop_requests.push_back(std::move(stop_));
+        } else if (type_ == "Bus"sv) {
+            RequireKeys({"is_roundtrip"sv, "name"sv, "stops"sv});
+            RequireTypes({"is_roundtrip"sv, "name"sv, "stops"sv});
+            bus_.name = stop_.name;
+            reader_.AddBusRequest(std::move(bus_));
+        }
+    }
+
+    JsonReader& reader_;
+    // Вложенность вне поддерева: 1 - корневой словарь, 2 - массив запросов,
+    // 3 - элемент base_requests, 4 - его road_distances или stops
+    int depth_ = 0;
+    Section section_ = Section::Other;
+    std::string section_name_;
+    // Поле текущего элемента base_requests, nullptr - поле, которое не разбирается
+    const Field* field_ = nullptr;
+    std::string_view distance_to_;
+    // Текущий элемент base_requests
+    std::string type_;
+    // Ключи элемента: бит i - ключ FIELDS[i] встретился (seen_keys_)
+    // или его значение другого типа (bad_keys_)
+    unsigned seen_keys_ = 0;
+    unsigned bad_keys_ = 0;
+    StopRequest stop_;
+    BusRequest bus_;
+    // Собираемое значение; discard_ - значение не нужно и только пропускается
+    std::optional<json::Builder> subtree_;
+    int subtree_depth_ = 0;
+    bool discard_ = false;
+    // Значения корневого словаря, кроме base_requests и stat_requests
+    json::Dict rest_;
+};
+
+void JsonReader::ParseCommandsFromEvents(std::istream& in) {
+    // текст остаётся у команд: имена без escape-последовательностей ссылаются прямо в него
+    const auto buffer = std::make_shared<const std::string>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    commands_.KeepText(buffer);
+    EventReader reader(*this);
+    json::Parse(*buffer, reader);
+    reader.Finish();
+}
+
+const RenderSettings& JsonReader::GetSettings() const {
+    return settings_;
+}
+
+const RoutingSettings& JsonReader::GetBaseSettings() const {
+    return base_settings_;
+}
+
+const Commands& JsonReader::GetCommands() const {
+    return commands_;
+}
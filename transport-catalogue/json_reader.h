@@ -7,31 +7,43 @@
 class JsonReader {
 public:    
     void ParseCommands(std::istream& in);
+    void ParseCommands(const json::Document& doc);
+    // То же, что ParseCommands, но команды заполняются прямо из событий разбора,
+    // без построения Document для всего входа
+    void ParseCommandsFromEvents(std::istream& in);
+    // То же, что ParseCommands, но элементы base_requests после быстрого
+    // структурного просмотра разбираются в threads потоках. Порядок команд
+    // и результат не зависят от числа потоков
+    void ParseCommandsParallel(std::istream& in, size_t threads);
     
     const domain::RenderSettings& GetSettings() const;
+
+    const domain::RoutingSettings& GetBaseSettings() const;
     
     const domain::Commands& GetCommands() const;
+
+    // Разбирает один запрос статистики в формате элемента stat_requests
+    domain::StatRequest ReadStatRequest(const json::Dict& request);
 private:
+    class EventReader;
+
     void ParseBaseRequest(const json::Dict& root);
+    void AddBaseRequest(const json::Dict& request);
     void ParseStatRequest(const json::Dict& root);
     void ParseSettings(const json::Dict& root);
+    void ParseBaseSettings(const json::Dict& root);
+    void AddBusRequest(domain::BusRequest request);
+    void AddStatRequest(const json::Dict& request);
     
     template <typename T>
-    T Default() {
+    static T Default() {
         return T();
     }
 
     template <typename T>
-    T CastNode(const json::Node& node);
-
-    template <typename T>
-    T GetValueOrDefault(const json::Dict& node, std::string key) {
-        for (auto ptr = node.find(key); ptr != node.end(); ptr = node.end()) {
-            return CastNode<T>(ptr->second);
-        }
-        return Default<T>();
-    }
+    static T CastNode(const json::Node& node);
     
     domain::Commands commands_;
     domain::RenderSettings settings_;
+    domain::RoutingSettings base_settings_;
 };
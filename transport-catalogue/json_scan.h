@@ -0,0 +1,70 @@
+#pragma once
+
+#include <bit>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace json {
+
+    // Первый из символов Chars в [begin, end) или end, по одному символу
+    template <char... Chars>
+    const char* FindAnyOfScalar(const char* begin, const char* end) {
+        while (begin != end && ((*begin != Chars) && ...)) {
+            ++begin;
+        }
+        return begin;
+    }
+
+#if defined(__SSE2__)
+    // То же по 16 байт за раз, остаток - FindAnyOfScalar
+    template <char... Chars>
+    const char* FindAnyOfSse2(const char* begin, const char* end) {
+        while (end - begin >= 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+            __m128i hits = _mm_setzero_si128();
+            ((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(Chars)))), ...);
+            if (const auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits)); mask != 0) {
+                return begin + std::countr_zero(mask);
+            }
+            begin += 16;
+        }
+        return FindAnyOfScalar<Chars...>(begin, end);
+    }
+#endif
+
+#if defined(__AVX2__)
+    // То же по 32 байта за раз, остаток - FindAnyOfSse2
+    template <char... Chars>
+    const char* FindAnyOfAvx2(const char* begin, const char* end) {
+        while (end - begin >= 32) {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+            __m256i hits = _mm256_setzero_si256();
+            ((hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(Chars)))), ...);
+            if (const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hits)); mask != 0) {
+                return begin + std::countr_zero(mask);
+            }
+            begin += 32;
+        }
+        return FindAnyOfSse2<Chars...>(begin, end);
+    }
+#endif
+
+    // Первый из символов Chars в [begin, end) или end.
+    // Проверяет по 32 (AVX2) или 16 (SSE2) байт за раз, остаток и сборки без
+    // этих наборов инструкций - по одному символу
+    template <char... Chars>
+    const char* FindAnyOf(const char* begin, const char* end) {
+#if defined(__AVX2__)
+        return FindAnyOfAvx2<Chars...>(begin, end);
+#elif defined(__SSE2__)
+        return FindAnyOfSse2<Chars...>(begin, end);
+#else
+        return FindAnyOfScalar<Chars...>(begin, end);
+#endif
+    }
+
+}
@@ -0,0 +1,297 @@
+#include "json_writer.h"
+#include "json_scan.h"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace json {
+
+    using namespace std;
+
+    namespace {
+        // при таком размере буфер передаётся в поток
+        constexpr size_t FLUSH_SIZE = 1 << 16;
+        constexpr size_t INDENT_STEP = 4;
+
+        // Замена экранируемого символа или пустая строка
+        string_view GetEscape(char c) {
+            switch (c) {
+                case '\r':
+                    return "\\r"sv;
+                case '\n':
+                    return "\\n"sv;
+                case '\t':
+                    return "\\t"sv;
+                case '"':
+                    return "\\\""sv;
+                case '\\':
+                    return "\\\\"sv;
+                default:
+                    return {};
+            }
+        }
+    }
+
+    void AppendString(std::string& out, std::string_view value) {
+        out += '"';
+        const char* run = value.data();
+        const char* const end = value.data() + value.size();
+        while (true) {
+            // участок без экранируемых символов копируется целиком
+            const char* special = FindAnyOf<'\r', '\n', '\t', '"', '\\'>(run, end);
+            out.append(run, special);
+            if (special == end) {
+                break;
+            }
+            out += GetEscape(*special);
+            run = special + 1;
+        }
+        out += '"';
+    }
+
+    void EscapeString(std::string& out, size_t begin) {
+        // первый проход считает замены, второй сдвигает текст к концу с последнего символа;
+        // участок до первой замены остаётся на месте
+        size_t extra = 0;
+        const char* const end = out.data() + out.size();
+        for (const char* special = out.data() + begin; ; ++special) {
+            special = FindAnyOf<'\r', '\n', '\t', '"', '\\'>(special, end);
+            if (special == end) {
+                break;
+            }
+            ++extra;
+        }
+        if (extra == 0) {
+            return;
+        }
+        size_t from = out.size();
+        out.resize(out.size() + extra);
+        size_t to = out.size();
+        while (to != from) {
+            const char c = out[--from];
+            if (const auto escape = GetEscape(c); !escape.empty()) {
+                out[--to] = escape[1];
+                out[--to] = escape[0];
+            } else {
+                out[--to] = c;
+            }
+        }
+    }
+
+    Writer::Writer(std::ostream& out, bool compact) : Writer(out, PrintOptions{compact}) {
+    }
+
+    Writer::Writer(std::ostream& out, const PrintOptions& options) : out_(out), options_(options) {
+        buffer_.reserve(FLUSH_SIZE + FLUSH_SIZE / 4);
+    }
+
+    Writer::~Writer() {
+        if (IsComplete()) {
+            Flush();
+        }
+    }
+
+    Writer& Writer::Key(std::string_view key) {
+        if (stack_.empty() || !stack_.back().is_dict || stack_.back().has_key) {
+            throw logic_error("dictionary has not been started");
+        }
+        BeginElement();
+        WriteString(key);
+        buffer_ += options_.compact ? ":"sv : ": "sv;
+        stack_.back().has_key = true;
+        return *this;
+    }
+
+    Writer& Writer::Value(std::nullptr_t) {
+        BeginValue();
+        buffer_ += "null"sv;
+        FlushIfFull();
+        return *this;
+    }
+
+    Writer& Writer::Value(bool value) {
+        BeginValue();
+        buffer_ += value ? "true"sv : "false"sv;
+        FlushIfFull();
+        return *this;
+    }
+
+    Writer& Writer::Value(int value) {
+        BeginValue();
+        char chars[16];
+        const auto result = to_chars(begin(chars), end(chars), value);
+        buffer_.append(chars, result.ptr);
+        FlushIfFull();
+        return *this;
+    }
+
+    Writer& Writer::Value(double value) {
+        BeginValue();
+        char chars[32];
+        // general с точностью 6 даёт ту же запись, что printf("%g") и operator<<
+        const auto result = options_.round_trip_doubles
+            ? to_chars(begin(chars), end(chars), value)
+            : to_chars(begin(chars), end(chars), value, chars_format::general, 6);
+        buffer_.append(chars, result.ptr);
+        FlushIfFull();
+        return *this;
+    }
+
+    Writer& Writer::Value(std::string_view value) {
+        BeginValue();
+        WriteString(value);
+        FlushIfFull();
+        return *this;
+    }
+
+    Writer& Writer::Value(const std::string& value) {
+        return Value(std::string_view(value));
+    }
+
+    Writer& Writer::Value(const char* value) {
+        return Value(std::string_view(value));
+    }
+
+    Writer& Writer::Value(const Node& node) {
+        if (node.IsArray()) {
+            StartArray();
+            for (const auto& item : node.AsArray()) {
+                Value(item);
+            }
+            return EndArray();
+        }
+        if (node.IsDict()) {
+            StartDict();
+            for (const auto& [key, item] : node.AsDict()) {
+                Key(key).Value(item);
+            }
+            return EndDict();
+        }
+        visit([this](const auto& value) {
+            using Type = decay_t<decltype(value)>;
+            if constexpr (is_same_v<Type, BufferString>) {
+                Value(value.text);
+            } else if constexpr (!is_same_v<Type, Array> && !is_same_v<Type, Dict>) {
+                Value(value);
+            }
+        }, node.GetValue());
+        return *this;
+    }
+
+    Writer& Writer::RawValue(std::string_view json) {
+        return RawValue({json});
+    }
+
+    Writer& Writer::RawValue(std::initializer_list<std::string_view> parts) {
+        BeginValue();
+        for (const auto part : parts) {
+            if (part.size() < FLUSH_SIZE) {
+                buffer_ += part;
+                FlushIfFull();
+            } else {
+                Flush();
+                out_.write(part.data(), static_cast<std::streamsize>(part.size()));
+            }
+        }
+        return *this;
+    }
+
+    Writer& Writer::StartDict() {
+        BeginValue();
+        buffer_ += '{';
+        WriteLineBreak();
+        stack_.push_back({true});
+        return *this;
+    }
+
+    Writer& Writer::StartArray() {
+        BeginValue();
+        buffer_ += '[';
+        WriteLineBreak();
+        stack_.push_back({false});
+        return *this;
+    }
+
+    Writer& Writer::EndDict() {
+        if (stack_.empty() || !stack_.back().is_dict || stack_.back().has_key) {
+            throw logic_error("dict is not opened");
+        }
+        End(true);
+        return *this;
+    }
+
+    Writer& Writer::EndArray() {
+        if (stack_.empty() || stack_.back().is_dict) {
+            throw logic_error("array is not opened");
+        }
+        End(false);
+        return *this;
+    }
+
+    bool Writer::IsComplete() const {
+        return root_written_ && stack_.empty();
+    }
+
+    void Writer::Flush() {
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+
+    void Writer::BeginValue() {
+        if (stack_.empty()) {
+            if (root_written_) {
+                throw logic_error("json is finished");
+            }
+            root_written_ = true;
+        } else if (stack_.back().is_dict) {
+            if (!stack_.back().has_key) {
+                throw logic_error("value has not been opened");
+            }
+            stack_.back().has_key = false;
+        } else {
+            BeginElement();
+        }
+    }
+
+    // Разделитель и отступ перед очередным элементом массива или ключом словаря
+    void Writer::BeginElement() {
+        auto& level = stack_.back();
+        if (!level.empty) {
+            buffer_ += ',';
+            WriteLineBreak();
+        }
+        level.empty = false;
+        WriteIndent(stack_.size());
+    }
+
+    void Writer::End(bool is_dict) {
+        stack_.pop_back();
+        WriteLineBreak();
+        WriteIndent(stack_.size());
+        buffer_ += is_dict ? '}' : ']';
+        FlushIfFull();
+    }
+
+    void Writer::WriteIndent(size_t depth) {
+        if (!options_.compact) {
+            buffer_.append(depth * INDENT_STEP, ' ');
+        }
+    }
+
+    void Writer::WriteLineBreak() {
+        if (!options_.compact) {
+            buffer_ += '\n';
+        }
+    }
+
+    void Writer::WriteString(std::string_view value) {
+        AppendString(buffer_, value);
+    }
+
+    void Writer::FlushIfFull() {
+        if (buffer_.size() >= FLUSH_SIZE) {
+            Flush();
+        }
+    }
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "json.h"
+
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+    // Экранирует на месте символы out, начиная с begin, как внутри строки JSON
+    void EscapeString(std::string& out, size_t begin = 0);
+
+    // Выводит JSON в поток по мере вызовов, без построения дерева Node.
+    // Оформление задаётся PrintOptions, как у Print; ключи словаря выводятся
+    // в порядке вызовов Key.
+    // Текст копится во внутреннем буфере и передаётся в поток крупными частями
+    // при Flush и при уничтожении законченного документа; незаконченный документ
+    // при уничтожении не дописывается, но уже переданные части остаются в потоке
+    class Writer {
+    public:
+        explicit Writer(std::ostream& out, bool compact = false);
+        Writer(std::ostream& out, const PrintOptions& options);
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        ~Writer();
+
+        Writer& Key(std::string_view key);
+        Writer& Value(std::nullptr_t);
+        Writer& Value(bool value);
+        Writer& Value(int value);
+        Writer& Value(double value);
+        Writer& Value(std::string_view value);
+        Writer& Value(const std::string& value);
+        Writer& Value(const char* value);
+        // Поддерево выводится с тем же оформлением
+        Writer& Value(const Node& node);
+        // Строка, которую write(std::string&) дописывает прямо в буфер вывода;
+        // экранируется на месте, без промежуточной копии
+        template <typename Write>
+        Writer& StringValue(Write&& write);
+        // Готовое значение JSON, например строка из AppendString, выводится как есть.
+        // Большое значение передаётся в поток напрямую, минуя буфер
+        Writer& RawValue(std::string_view json);
+        // Готовое значение JSON, записанное частями подряд
+        Writer& RawValue(std::initializer_list<std::string_view> parts);
+        Writer& StartDict();
+        Writer& StartArray();
+        Writer& EndDict();
+        Writer& EndArray();
+
+        // Закончен ли документ верхнего уровня
+        bool IsComplete() const;
+        void Flush();
+
+    private:
+        struct Level {
+            bool is_dict = false;
+            bool empty = true;
+            // для словаря: ключ выведен, ждём значение
+            bool has_key = false;
+        };
+
+        void BeginValue();
+        void BeginElement();
+        void End(bool is_dict);
+        void WriteIndent(size_t depth);
+        void WriteLineBreak();
+        void WriteString(std::string_view value);
+        void FlushIfFull();
+
+        std::ostream& out_;
+        const PrintOptions options_;
+        std::string buffer_;
+        std::vector<Level> stack_;
+        bool root_written_ = false;
+    };
+
+    // Дописывает value в out строкой JSON: в кавычках и с экранированием
+    void AppendString(std::string& out, std::string_view value);
+
+    template <typename Write>
+    Writer& Writer::StringValue(Write&& write) {
+        BeginValue();
+        buffer_ += '"';
+        const size_t begin = buffer_.size();
+        write(buffer_);
+        EscapeString(buffer_, begin);
+        buffer_ += '"';
+        FlushIfFull();
+        return *this;
+    }
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Замеряет время жизни объекта и выводит его в out при уничтожении.
+// Если out == nullptr, ничего не выводит.
+class LogDuration {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    LogDuration(std::string id, std::ostream* out = &std::cerr) : id_(std::move(id)), out_(out) {
+    }
+
+    LogDuration(const LogDuration&) = delete;
+    LogDuration& operator=(const LogDuration&) = delete;
+
+    ~LogDuration() {
+        if (out_) {
+            const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start_time_);
+            *out_ << id_ << ": " << duration.count() << " ms" << std::endl;
+        }
+    }
+
+private:
+    const std::string id_;
+    std::ostream* const out_;
+    const Clock::time_point start_time_ = Clock::now();
+};
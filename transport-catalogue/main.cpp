@@ -1,11 +1,17 @@
 #include "transport_catalogue.h"
 #include "transport_router.h"
 #include "json.h"
+#include "json_writer.h"
 #include "json_reader.h"
 #include "map_renderer.h"
+#include "parallel.h"
 #include "request_handler.h"
+#include "versioned_catalogue.h"
 
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
 
 using namespace std;
 using namespace transport;
@@ -14,21 +20,107 @@ using namespace renderer;
 using namespace handler;
 using namespace router;
 
-int main() {
-    TransportCatalogue db;
+namespace {
+
+void PrintLine(Writer& line, ostream& out) {
+    line.Flush();
+    out << '\n' << flush;
+}
+
+// Построчный (NDJSON) режим: каждая непустая строка входа - один запрос статистики
+// в формате элемента stat_requests. Ответ выводится одной строкой сразу после вычисления.
+// Ошибка в запросе не прерывает работу: на неё выводится error_message.
+void ServeStream(istream& in, ostream& out, JsonReader& reader, const RequestHandler& handler, const PrintOptions& options) {
+    for (const auto& request : reader.GetCommands().stat_requests) {
+        Writer line(out, options);
+        handler.ApplyCommand(request, line);
+        PrintLine(line, out);
+    }
+    string line;
+    while (getline(in, line)) {
+        if (line.find_first_not_of(" \t\r"sv) == string::npos) {
+            continue;
+        }
+        optional<int> id;
+        try {
+            const Document doc = Load(string_view(line));
+            const auto request = reader.ReadStatRequest(doc.GetRoot().AsDict());
+            id = request.id;
+            Writer answer(out, options);
+            handler.ApplyCommand(request, answer);
+            PrintLine(answer, out);
+        } catch (const exception& e) {
+            Writer error(out, options);
+            error.StartDict()
+                 .Key("error_message"sv).Value(string_view(e.what()));
+            if (id) {
+                error.Key("request_id"sv).Value(*id);
+            }
+            error.EndDict();
+            PrintLine(error, out);
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    // --timings: вывести в stderr длительность этапов загрузки
+    // --stream: после базы читать запросы статистики построчно и отвечать на каждый сразу
+    // --compact: выводить ответ без пробелов и переводов строк (в --stream всегда так)
+    // --round-trip-doubles: выводить double без потери точности
+    // --parallel-parse: разбирать base_requests во всех ядрах
+    // --input <файл>: читать документ из файла, а не из stdin (в --stream запросы
+    // по-прежнему идут из stdin)
+    bool print_timings = false;
+    bool stream = false;
+    bool parallel_parse = false;
+    string input_path;
+    PrintOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i] == "--timings"sv) {
+            print_timings = true;
+        } else if (argv[i] == "--stream"sv) {
+            stream = true;
+        } else if (argv[i] == "--compact"sv) {
+            options.compact = true;
+        } else if (argv[i] == "--round-trip-doubles"sv) {
+            options.round_trip_doubles = true;
+        } else if (argv[i] == "--parallel-parse"sv) {
+            parallel_parse = true;
+        } else if (argv[i] == "--input"sv && i + 1 < argc) {
+            input_path = argv[++i];
+        }
+    }
+
     JsonReader reader;
-    reader.ParseCommands(cin);
+    if (!input_path.empty()) {
+        reader.ParseCommands(LoadFile(input_path));
+    } else if (stream) {
+        // Читается ровно один документ, остаток входа - запросы
+        reader.ParseCommands(LoadBuffer(ReadDocumentText(cin)));
+    } else if (parallel_parse) {
+        reader.ParseCommandsParallel(cin, parallel::GetThreadCount());
+    } else {
+        reader.ParseCommandsFromEvents(cin);
+    }
 
     const auto& commands = reader.GetCommands();
     const auto& settings = reader.GetSettings();
     const auto& base_settings = reader.GetBaseSettings();
 
-    CatalogueConstructor constructor(db, base_settings);
-    MapRenderer renderer(settings, db);
-    constructor.FillFromCommands(commands);
-    TransportRouter router(db);
-    RequestHandler applyer(db, renderer, router);
-    const auto& ans = applyer.ApplyCommands(commands);
+    VersionedCatalogue catalogue(base_settings);
+    catalogue.Update(commands, print_timings ? &cerr : nullptr);
 
-    Print(ans, cout);    
+    const auto snapshot = catalogue.Pin();
+    const auto& db = snapshot->GetCatalogue();
+    MapRenderer renderer(settings, db, parallel::GetThreadCount(), print_timings ? &cerr : nullptr);
+    RequestHandler applyer(db, renderer, snapshot->GetRouter(), snapshot->GetVersion());
+    if (stream) {
+        options.compact = true;
+        ServeStream(cin, cout, reader, applyer, options);
+        return 0;
+    }
+    Writer ans(cout, options);
+    applyer.ApplyCommands(commands, ans);
 }
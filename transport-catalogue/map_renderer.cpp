@@ -1,120 +1,829 @@
 #include "map_renderer.h"
+#include "json_writer.h"
+#include "parallel.h"
 
 #include <cassert>
+#include <cmath>
+#include <functional>
 
 using namespace svg;
 using namespace std::literals;
 
 namespace renderer {
 
+namespace {
+
+const size_t TILE_ITEMS_PER_CELL = 4;
+// меньшие карты выводятся в одном потоке: запуск потоков дороже
+const size_t PARALLEL_RENDER_MIN_OBJECTS = 4096;
+// Примерная длина в символах, по ней карта делится между потоками поровну
+const size_t LINE_COST = 160;
+const size_t LINE_POINT_COST = 16;
+const size_t TEXT_COST = 220;
+const size_t CIRCLE_COST = 60;
+const int MAX_TILE_GRID_SIDE = 1024;
+
+struct Box {
+    double min_x;
+    double min_y;
+    double max_x;
+    double max_y;
+
+    Box Expanded(double margin) const {
+        return {min_x - margin, min_y - margin, max_x + margin, max_y + margin};
+    }
+
+    bool Intersects(const Box& other) const {
+        return min_x <= other.max_x && other.min_x <= max_x && min_y <= other.max_y && other.min_y <= max_y;
+    }
+};
+
+Box MakeBox(svg::Point a, svg::Point b) {
+    return {std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.x, b.x), std::max(a.y, b.y)};
+}
+
+// Задевает ли отрезок прямоугольник (отсечение Лианга - Барски)
+bool SegmentIntersects(svg::Point from, svg::Point to, const Box& box) {
+    double t_min = 0.;
+    double t_max = 1.;
+    const auto clip = [&t_min, &t_max](double p, double q) {
+        if (p == 0.) {
+            return q >= 0.;
+        }
+        const double t = q / p;
+        if (p < 0.) {
+            t_min = std::max(t_min, t);
+        } else {
+            t_max = std::min(t_max, t);
+        }
+        return t_min <= t_max;
+    };
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    return clip(-dx, from.x - box.min_x) && clip(dx, box.max_x - from.x)
+        && clip(-dy, from.y - box.min_y) && clip(dy, box.max_y - from.y);
+}
+
+double DistanceToSegment(svg::Point point, svg::Point from, svg::Point to) {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double length2 = dx * dx + dy * dy;
+    double t = 0.;
+    if (length2 > 0.) {
+        t = std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length2, 0., 1.);
+    }
+    return std::hypot(point.x - (from.x + t * dx), point.y - (from.y + t * dy));
+}
+
+// Оценка сверху места, которое занимает надпись: символ не шире размера шрифта
+Box MakeLabelBox(svg::Point position, svg::Point offset, double font_size, size_t length, double margin) {
+    const svg::Point anchor{position.x + offset.x, position.y + offset.y};
+    return Box{anchor.x, anchor.y - font_size, anchor.x + font_size * length, anchor.y + font_size / 2}.Expanded(margin);
+}
+
+int GetColumn(const TileIndex& index, double x) {
+    return std::clamp(static_cast<int>(std::floor(x / index.cell_width)), 0, index.columns - 1);
+}
+
+int GetRow(const TileIndex& index, double y) {
+    return std::clamp(static_cast<int>(std::floor(y / index.cell_height)), 0, index.rows - 1);
+}
+
+// Клетки сетки индекса, которые задевает box
+template <typename Visitor>
+void ForEachCell(const TileIndex& index, const Box& box, Visitor&& visit) {
+    const int last_row = GetRow(index, box.max_y);
+    const int last_column = GetColumn(index, box.max_x);
+    for (int r = GetRow(index, box.min_y); r <= last_row; ++r) {
+        for (int c = GetColumn(index, box.min_x); c <= last_column; ++c) {
+            visit(static_cast<size_t>(r) * index.columns + c);
+        }
+    }
+}
+
+// Клетки, через которые проходит отрезок: в каждой строке сетки - столбцы между
+// точками входа отрезка в строку и выхода из неё. Длинный отрезок занимает
+// клетки вдоль себя, а не всю свою рамку
+template <typename Visitor>
+void ForEachCell(const TileIndex& index, svg::Point from, svg::Point to, Visitor&& visit) {
+    if (from.y > to.y) {
+        std::swap(from, to);
+    }
+    const auto x_at = [from, to](double y) {
+        return from.x + (to.x - from.x) * (y - from.y) / (to.y - from.y);
+    };
+    // запас на погрешность вычисления точек пересечения с границами строк
+    const double tolerance = EPSILON * index.cell_width;
+    const int first_row = GetRow(index, from.y);
+    const int last_row = GetRow(index, to.y);
+    for (int r = first_row; r <= last_row; ++r) {
+        const double x_begin = r == first_row ? from.x : x_at(r * index.cell_height);
+        const double x_end = r == last_row ? to.x : x_at((r + 1) * index.cell_height);
+        const int last_column = GetColumn(index, std::max(x_begin, x_end) + tolerance);
+        for (int c = GetColumn(index, std::min(x_begin, x_end) - tolerance); c <= last_column; ++c) {
+            visit(static_cast<size_t>(r) * index.columns + c);
+        }
+    }
+}
+
+// Из координат карты в координаты плитки
+struct TileTransform {
+    svg::Point origin;
+    double scale;
+
+    svg::Point operator()(svg::Point point) const {
+        return {(point.x - origin.x) * scale, (point.y - origin.y) * scale};
+    }
+};
+
+}  // namespace
+
 bool IsZero(double value) {
     return std::abs(value) < EPSILON;
 }
     
-MapRenderer::MapRenderer(const domain::RenderSettings& settings, const transport::TransportCatalogue& db) : settings_(settings), db_(db) {
+size_t HashSettings(const domain::RenderSettings& settings) {
+    size_t hash = 0;
+    auto mix = [&hash](const auto& value) {
+        hash = hash * 37 + std::hash<std::decay_t<decltype(value)>>{}(value);
+    };
+    for (double value : {settings.width, settings.height, settings.padding, settings.line_width,
+                         settings.stop_radius, settings.bus_label_font_size, settings.bus_label_offset.x,
+                         settings.bus_label_offset.y, settings.stop_label_offset.x,
+                         settings.stop_label_offset.y, settings.underlayer_width}) {
+        mix(value);
+    }
+    mix(settings.simplify_tolerance);
+    mix(settings.style_classes);
+    mix(settings.stop_label_font_size);
+    mix(settings.underlayer_color);
+    for (const auto& color : settings.color_palette) {
+        mix(color);
+    }
+    return hash;
+}
+
+MapRenderer::MapRenderer(const domain::RenderSettings& settings, const transport::TransportCatalogue& db, size_t threads,
+                         std::ostream* log)
+    : settings_(settings), db_(db), threads_(std::max<size_t>(threads, 1)), log_(log), styles_(MakeStyles(settings)) {
+}
+
+// Имена классов задаются только при settings.style_classes, иначе оформление выводится атрибутами
+MapRenderer::Styles MapRenderer::MakeStyles(const domain::RenderSettings& settings) {
+    const auto name = [&settings](std::string_view class_name) {
+        return settings.style_classes ? std::string{class_name} : std::string{};
+    };
+    svg::Style route_line;
+    route_line.class_name = name("route"sv);
+    route_line.fill = svg::DefaultColor;
+    route_line.stroke_width = settings.line_width;
+    route_line.stroke_linecap = StrokeLineCap::ROUND;
+    route_line.stroke_linejoin = StrokeLineJoin::ROUND;
+
+    svg::Style underlayer;
+    underlayer.fill = settings.underlayer_color;
+    underlayer.stroke = settings.underlayer_color;
+    underlayer.stroke_width = settings.underlayer_width;
+    underlayer.stroke_linecap = StrokeLineCap::ROUND;
+    underlayer.stroke_linejoin = StrokeLineJoin::ROUND;
+    underlayer.font_family = "Verdana"s;
+
+    svg::Style bus_label;
+    bus_label.class_name = name("bus-label"sv);
+    bus_label.font_family = "Verdana"s;
+    bus_label.font_weight = "bold"s;
+
+    svg::Style bus_label_underlayer = underlayer;
+    bus_label_underlayer.class_name = name("bus-label-underlayer"sv);
+    bus_label_underlayer.font_weight = "bold"s;
+
+    svg::Style stop_circle;
+    stop_circle.class_name = name("stop"sv);
+    stop_circle.fill = svg::Color{"white"sv};
+
+    svg::Style stop_label;
+    stop_label.class_name = name("stop-label"sv);
+    stop_label.fill = svg::Color{"black"sv};
+    stop_label.font_family = "Verdana"s;
+
+    svg::Style stop_label_underlayer = std::move(underlayer);
+    stop_label_underlayer.class_name = name("stop-label-underlayer"sv);
+
+    return {
+        std::make_shared<const svg::Style>(std::move(route_line)),
+        std::make_shared<const svg::Style>(std::move(bus_label)),
+        std::make_shared<const svg::Style>(std::move(bus_label_underlayer)),
+        std::make_shared<const svg::Style>(std::move(stop_circle)),
+        std::make_shared<const svg::Style>(std::move(stop_label)),
+        std::make_shared<const svg::Style>(std::move(stop_label_underlayer)),
+    };
+}
+
+void MapRenderer::AddStyles(svg::Document& doc) const {
+    for (const auto* style : {&styles_.route_line, &styles_.bus_label, &styles_.bus_label_underlayer,
+                              &styles_.stop_circle, &styles_.stop_label, &styles_.stop_label_underlayer}) {
+        doc.AddStyle(*style);
+    }
 }
     
 const svg::Document MapRenderer::Render() const {
-    const auto& allstops = db_.GetStops();
-    SphereProjector projector(allstops.cbegin(), allstops.cend(), settings_.width, settings_.height, settings_.padding);
+    const auto& layout = GetLayout();
     svg::Document doc;
-    RenderRoutes(projector, doc);
-    RenderStops(projector, doc);
+    AddStyles(doc);
+    doc.Reserve(CountObjects(layout));
+    RenderItems(layout, 0, GetItemCount(layout), doc);
     return doc;
 }
-    
-void MapRenderer::RenderRoutes(const SphereProjector& projector, svg::Document& doc) const {
-    std::vector<std::string_view> buses = db_.GetBuses();
-    std::sort(buses.begin(), buses.end());
-    auto color_it = settings_.color_palette.begin();
-    for (const auto& bus : buses) {
-        const auto descr = db_.GetBus(bus);
-        if (!descr || descr->stops.empty()) {
+
+// Элементы карты в порядке вывода: маршруты для линий, маршруты для названий,
+// остановки для кругов, остановки для названий
+size_t MapRenderer::GetItemCount(const MapLayout& layout) const {
+    return 2 * (layout.routes.size() + layout.stops.size());
+}
+
+// Объекты элементов [begin, end); части, выведенные подряд, дают ту же карту, что Render
+void MapRenderer::RenderItems(const MapLayout& layout, size_t begin, size_t end, svg::Document& doc) const {
+    const size_t routes = layout.routes.size();
+    const size_t stops = layout.stops.size();
+    const std::array<size_t, 5> layers{0, routes, 2 * routes, 2 * routes + stops, 2 * (routes + stops)};
+    for (size_t layer = 0; layer + 1 < layers.size(); ++layer) {
+        const size_t from = std::max(begin, layers[layer]);
+        const size_t to = std::min(end, layers[layer + 1]);
+        if (from >= to) {
             continue;
         }
-        auto line = std::make_unique<svg::Polyline>();
-        for (const auto& stop : descr->stops) {
-            line->AddPoint(projector(db_.GetStop(stop)->place));
-        }
-        const auto& color = *color_it;
-        line->SetStrokeColor(color);
-        line->SetFillColor(svg::DefaultColor);
-        line->SetStrokeWidth(settings_.line_width);
-        line->SetStrokeLineCap(StrokeLineCap::ROUND);
-        line->SetStrokeLineJoin(StrokeLineJoin::ROUND);
-        doc.AddPtr(std::move(line));        
-        if (++color_it == settings_.color_palette.end()) {
-            color_it = settings_.color_palette.begin();
+        const size_t first = from - layers[layer];
+        const size_t last = to - layers[layer];
+        switch (layer) {
+            case 0:
+                RenderRouteLines(layout, first, last, doc);
+                break;
+            case 1:
+                RenderBusLabels(layout, first, last, doc);
+                break;
+            case 2:
+                RenderStopCircles(layout, first, last, doc);
+                break;
+            default:
+                RenderStopLabels(layout, first, last, doc);
+                break;
         }
     }
-    
-    color_it = settings_.color_palette.begin();
-    for (const auto& bus : buses) {
+}
+
+const MapLayout& MapRenderer::GetLayout() const {
+    std::call_once(layout_flag_, [this] {
+        layout_ = MakeLayout();
+    });
+    return layout_;
+}
+
+// Остановки проецируются один раз: точка каждой остановки с маршрутами
+// записывается по её StopDescription::index, слои берут её оттуда
+MapLayout MapRenderer::MakeLayout() const {
+    MapLayout layout;
+    std::vector<char> served(db_.GetStopsCount(), 0);
+    std::vector<geo::Coordinates> places;
+    for (const auto& bus : db_.GetBuses()) {
         const auto descr = db_.GetBus(bus);
         if (!descr || descr->stops.empty()) {
             continue;
         }
-        const auto& color = *color_it;
+        for (size_t i = 0; i < descr->stops.size(); ++i) {
+            const size_t index = descr->stop_indexes[i];
+            if (!served[index]) {
+                served[index] = 1;
+                layout.stops.push_back({descr->stops[i], index});
+                places.push_back(db_.GetStop(descr->stops[i])->place);
+            }
+        }
+        MapLayout::Route route{descr, {}, {}};
         for (const auto& stop : descr->final_stops) {
-             auto text = MakeBaseBusText(stop, bus, projector);
-             text->SetFillColor(color);
-             auto underlayer = MakeBaseBusText(stop, bus, projector);
-             underlayer->SetFillColor(settings_.underlayer_color);
-             underlayer->SetStrokeColor(settings_.underlayer_color);
-             underlayer->SetStrokeWidth(settings_.underlayer_width);
-             underlayer->SetStrokeLineCap(StrokeLineCap::ROUND);
-             underlayer->SetStrokeLineJoin(StrokeLineJoin::ROUND);
-             doc.AddPtr(std::move(underlayer));
-             doc.AddPtr(std::move(text));
-        }  
-        if (++color_it == settings_.color_palette.end()) {
-            color_it = settings_.color_palette.begin();
+            route.final_stops.push_back(db_.GetStop(stop)->index);
+        }
+        layout.routes.push_back(std::move(route));
+    }
+    // places идут в порядке layout.stops, поэтому точки считаются до сортировки
+    const SphereProjector projector(places.cbegin(), places.cend(), settings_.width, settings_.height, settings_.padding);
+    layout.points.resize(served.size());
+    for (size_t i = 0; i < layout.stops.size(); ++i) {
+        layout.points[layout.stops[i].second] = projector(places[i]);
+    }
+    std::sort(layout.stops.begin(), layout.stops.end());
+    std::sort(layout.routes.begin(), layout.routes.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.bus->id < rhs.bus->id;
+    });
+    if (settings_.simplify_tolerance > 0.) {
+        SimplifyLines(layout);
+    }
+    return layout;
+}
+
+// Douglas - Peucker для каждой линии маршрута: вершина остаётся, если без неё линия
+// сместилась бы больше чем на simplify_tolerance пикселей
+void MapRenderer::SimplifyLines(MapLayout& layout) const {
+    size_t points_before = 0;
+    size_t points_after = 0;
+    std::vector<svg::Point> line;
+    std::vector<char> keep;
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (auto& route : layout.routes) {
+        const auto& path = route.bus->stop_indexes;
+        line.clear();
+        for (const size_t index : path) {
+            line.push_back(layout.points[index]);
+        }
+        keep.assign(line.size(), 0);
+        keep.front() = 1;
+        keep.back() = 1;
+        ranges.assign({{0, line.size() - 1}});
+        while (!ranges.empty()) {
+            const auto [first, last] = ranges.back();
+            ranges.pop_back();
+            double max_distance = settings_.simplify_tolerance;
+            size_t farthest = first;
+            for (size_t i = first + 1; i < last; ++i) {
+                const double distance = DistanceToSegment(line[i], line[first], line[last]);
+                if (distance > max_distance) {
+                    max_distance = distance;
+                    farthest = i;
+                }
+            }
+            if (farthest != first) {
+                keep[farthest] = 1;
+                ranges.push_back({first, farthest});
+                ranges.push_back({farthest, last});
+            }
+        }
+        for (size_t i = 0; i < line.size(); ++i) {
+            if (keep[i]) {
+                route.line_vertices.push_back(i);
+            }
+        }
+        points_before += line.size();
+        points_after += route.line_vertices.size();
+    }
+    if (log_) {
+        *log_ << "route line points: "sv << points_before << " -> "sv << points_after << std::endl;
+    }
+}
+
+const TileIndex& MapRenderer::GetTileIndex() const {
+    std::call_once(tile_index_flag_, [this] {
+        tile_index_ = MakeTileIndex();
+    });
+    return tile_index_;
+}
+
+TileIndex MapRenderer::MakeTileIndex() const {
+    const auto& layout = GetLayout();
+    TileIndex index;
+    index.segment_offsets.reserve(layout.routes.size() + 1);
+    index.segment_offsets.push_back(0);
+    index.label_offsets.reserve(layout.routes.size() + 1);
+    index.label_offsets.push_back(0);
+    size_t max_bus_name = 0;
+    for (const auto& route : layout.routes) {
+        index.segment_offsets.push_back(index.segment_offsets.back() + route.bus->stop_indexes.size() - 1);
+        index.label_offsets.push_back(index.label_offsets.back() + route.final_stops.size());
+        max_bus_name = std::max(max_bus_name, route.bus->id.size());
+    }
+
+    std::vector<size_t> position(layout.points.size());
+    size_t max_stop_name = 0;
+    for (size_t s = 0; s < layout.stops.size(); ++s) {
+        position[layout.stops[s].second] = s;
+        max_stop_name = std::max(max_stop_name, layout.stops[s].first.size());
+    }
+    index.stop_label_offsets.assign(layout.stops.size() + 1, 0);
+    for (const auto& route : layout.routes) {
+        for (const size_t stop : route.final_stops) {
+            ++index.stop_label_offsets[position[stop] + 1];
+        }
+    }
+    for (size_t s = 1; s < index.stop_label_offsets.size(); ++s) {
+        index.stop_label_offsets[s] += index.stop_label_offsets[s - 1];
+    }
+    index.stop_labels.resize(index.label_offsets.back());
+    std::vector<size_t> label_fill(index.stop_label_offsets.begin(), index.stop_label_offsets.end() - 1);
+    for (size_t r = 0; r < layout.routes.size(); ++r) {
+        const auto& final_stops = layout.routes[r].final_stops;
+        for (size_t k = 0; k < final_stops.size(); ++k) {
+            index.stop_labels[label_fill[position[final_stops[k]]]++] = index.label_offsets[r] + k;
+        }
+    }
+    const auto reach = [this](svg::Point offset, double font_size, size_t length) {
+        return std::abs(offset.x) + std::abs(offset.y) + font_size * (length + 1) + settings_.underlayer_width / 2;
+    };
+    index.label_reach = std::max(reach(settings_.stop_label_offset, settings_.stop_label_font_size, max_stop_name),
+                                 reach(settings_.bus_label_offset, settings_.bus_label_font_size, max_bus_name));
+
+    // Клетки примерно квадратные, в среднем по TILE_ITEMS_PER_CELL элементов на клетку
+    const size_t item_count = index.segment_offsets.back() + layout.stops.size();
+    const double width = std::max(settings_.width, 1.);
+    const double height = std::max(settings_.height, 1.);
+    const double cells = std::max<double>(1., static_cast<double>(item_count / TILE_ITEMS_PER_CELL));
+    const double cell_size = std::sqrt(width * height / cells);
+    index.rows = std::clamp(static_cast<int>(height / cell_size) + 1, 1, MAX_TILE_GRID_SIDE);
+    index.columns = std::clamp(static_cast<int>(width / cell_size) + 1, 1, MAX_TILE_GRID_SIDE);
+    index.cell_width = width / index.columns;
+    index.cell_height = height / index.rows;
+
+    // номера элементов по порядку: отрезки маршрутов, затем остановки
+    const auto for_each_item_cell = [&layout, &index](auto&& visit) {
+        size_t item = 0;
+        for (const auto& route : layout.routes) {
+            const auto& path = route.bus->stop_indexes;
+            for (size_t i = 1; i < path.size(); ++i, ++item) {
+                ForEachCell(index, layout.points[path[i - 1]], layout.points[path[i]], [&visit, item](size_t cell) {
+                    visit(item, cell);
+                });
+            }
+        }
+        for (const auto& [stop, stop_index] : layout.stops) {
+            const svg::Point point = layout.points[stop_index];
+            visit(item++, static_cast<size_t>(GetRow(index, point.y)) * index.columns + GetColumn(index, point.x));
+        }
+    };
+    index.cell_offsets.assign(static_cast<size_t>(index.rows) * index.columns + 1, 0);
+    for_each_item_cell([&index](size_t, size_t cell) {
+        ++index.cell_offsets[cell + 1];
+    });
+    for (size_t cell = 1; cell < index.cell_offsets.size(); ++cell) {
+        index.cell_offsets[cell] += index.cell_offsets[cell - 1];
+    }
+    index.items.resize(index.cell_offsets.back());
+    std::vector<size_t> fill(index.cell_offsets.begin(), index.cell_offsets.end() - 1);
+    for_each_item_cell([&index, &fill](size_t item, size_t cell) {
+        index.items[fill[cell]++] = item;
+    });
+    return index;
+}
+
+bool MapRenderer::HasTile(int zoom, int x, int y) const {
+    if (zoom < 0 || zoom > MAX_TILE_ZOOM) {
+        return false;
+    }
+    const int tiles = 1 << zoom;
+    return x >= 0 && x < tiles && y >= 0 && y < tiles;
+}
+
+svg::Document MapRenderer::RenderTile(int zoom, int x, int y) const {
+    const auto& layout = GetLayout();
+    const auto& index = GetTileIndex();
+    const double scale = std::ldexp(1., zoom);
+    const double tile_width = settings_.width / scale;
+    const double tile_height = settings_.height / scale;
+    const TileTransform transform{{x * tile_width, y * tile_height}, scale};
+    const Box tile{0., 0., settings_.width, settings_.height};
+    const Box line_area = tile.Expanded(settings_.line_width / 2);
+
+    // Кандидаты из сетки; запас - на толщину линий, радиус остановок и длину надписей
+    const double margin = std::max({settings_.line_width / 2, settings_.stop_radius, index.label_reach}) / scale;
+    const Box query = Box{transform.origin.x, transform.origin.y,
+                          transform.origin.x + tile_width, transform.origin.y + tile_height}.Expanded(margin);
+    const size_t segment_count = index.segment_offsets.back();
+    std::vector<size_t> segments;
+    std::vector<size_t> stops;
+    ForEachCell(index, query, [&](size_t cell) {
+        for (size_t i = index.cell_offsets[cell]; i < index.cell_offsets[cell + 1]; ++i) {
+            const size_t item = index.items[i];
+            if (item < segment_count) {
+                segments.push_back(item);
+            } else {
+                stops.push_back(item - segment_count);
+            }
+        }
+    });
+    for (auto* items : {&segments, &stops}) {
+        std::sort(items->begin(), items->end());
+        items->erase(std::unique(items->begin(), items->end()), items->end());
+    }
+    std::vector<size_t> labels;
+    for (const size_t stop : stops) {
+        labels.insert(labels.end(), index.stop_labels.begin() + index.stop_label_offsets[stop],
+                      index.stop_labels.begin() + index.stop_label_offsets[stop + 1]);
+    }
+    std::sort(labels.begin(), labels.end());
+
+    svg::Document doc;
+    AddStyles(doc);
+    // подряд идущие отрезки маршрута, задевающие плитку, выводятся одной линией
+    std::optional<svg::Polyline> line;
+    size_t route = 0;
+    size_t line_route = 0;
+    size_t last_segment = 0;
+    for (const size_t segment : segments) {
+        while (index.segment_offsets[route + 1] <= segment) {
+            ++route;
+        }
+        const auto& path = layout.routes[route].bus->stop_indexes;
+        const size_t i = segment - index.segment_offsets[route];
+        const svg::Point from = transform(layout.points[path[i]]);
+        const svg::Point to = transform(layout.points[path[i + 1]]);
+        if (!SegmentIntersects(from, to, line_area)) {
+            continue;
+        }
+        if (line && line_route == route && last_segment + 1 == segment) {
+            line->AddPoint(to);
+        } else {
+            if (line) {
+                doc.Add(std::move(*line));
+            }
+            line = MakeRouteLine(GetRouteColor(route));
+            line->AddPoint(from).AddPoint(to);
+            line_route = route;
+        }
+        last_segment = segment;
+    }
+    if (line) {
+        doc.Add(std::move(*line));
+    }
+
+    route = 0;
+    for (const size_t label : labels) {
+        while (index.label_offsets[route + 1] <= label) {
+            ++route;
+        }
+        const auto& bus = *layout.routes[route].bus;
+        const svg::Point position = transform(layout.points[layout.routes[route].final_stops[label - index.label_offsets[route]]]);
+        if (!MakeLabelBox(position, settings_.bus_label_offset, settings_.bus_label_font_size, bus.id.size(),
+                          settings_.underlayer_width / 2).Intersects(tile)) {
+            continue;
+        }
+        auto text = MakeBaseBusText(styles_.bus_label, position, bus.id);
+        text.SetFillColor(GetRouteColor(route));
+        doc.Add(MakeBaseBusText(styles_.bus_label_underlayer, position, bus.id));
+        doc.Add(std::move(text));
+    }
+
+    for (const size_t stop : stops) {
+        const svg::Point center = transform(layout.points[layout.stops[stop].second]);
+        if (MakeBox(center, center).Expanded(settings_.stop_radius).Intersects(tile)) {
+            doc.Add(MakeStopCircle(center));
+        }
+    }
+    for (const size_t stop : stops) {
+        const auto& [name, stop_index] = layout.stops[stop];
+        const svg::Point position = transform(layout.points[stop_index]);
+        if (!MakeLabelBox(position, settings_.stop_label_offset, settings_.stop_label_font_size, name.size(),
+                          settings_.underlayer_width / 2).Intersects(tile)) {
+            continue;
+        }
+        doc.Add(MakeBaseStopText(styles_.stop_label_underlayer, position, name));
+        doc.Add(MakeBaseStopText(styles_.stop_label, position, name));
+    }
+    return doc;
+}
+
+std::string MapRenderer::RenderTileToString(int zoom, int x, int y) const {
+    std::string out;
+    RenderTile(zoom, x, y).Render(out);
+    return out;
+}
+
+svg::Document MapRenderer::RenderRoute(const transport::PathDescription& path) const {
+    const auto& layout = GetLayout();
+    struct Ride {
+        size_t route;
+        // отрезок [first, last] в stop_indexes маршрута
+        size_t first;
+        size_t last;
+    };
+    std::vector<Ride> rides;
+    for (const auto& item : path.route) {
+        if (item.type != transport::PathType::Bus) {
+            continue;
+        }
+        // по маршруту без остановок не проехать, поэтому он есть в layout.routes
+        const auto route = std::lower_bound(layout.routes.begin(), layout.routes.end(), item.id,
+                                            [](const MapLayout::Route& probe, std::string_view id) {
+            return probe.bus->id < id;
+        });
+        assert(route != layout.routes.end() && route->bus->id == item.id);
+        rides.push_back({static_cast<size_t>(route - layout.routes.begin()), item.first_stop,
+                         item.first_stop + static_cast<size_t>(*item.span)});
+    }
+
+    svg::Document doc;
+    AddStyles(doc);
+    for (const auto& ride : rides) {
+        const auto& stop_indexes = layout.routes[ride.route].bus->stop_indexes;
+        auto line = MakeRouteLine(GetRouteColor(ride.route));
+        for (size_t i = ride.first; i <= ride.last; ++i) {
+            line.AddPoint(layout.points[stop_indexes[i]]);
+        }
+        doc.Add(std::move(line));
+    }
+    for (const auto& ride : rides) {
+        const auto& bus = *layout.routes[ride.route].bus;
+        for (const size_t i : {ride.first, ride.last}) {
+            const svg::Point position = layout.points[bus.stop_indexes[i]];
+            auto text = MakeBaseBusText(styles_.bus_label, position, bus.id);
+            text.SetFillColor(GetRouteColor(ride.route));
+            doc.Add(MakeBaseBusText(styles_.bus_label_underlayer, position, bus.id));
+            doc.Add(std::move(text));
+        }
+    }
+
+    // остановки поездок в порядке проезда, каждая один раз: номер в stops маршрута и маршрут
+    std::vector<std::pair<size_t, const transport::BusDescription*>> stops;
+    std::vector<bool> added(layout.points.size());
+    for (const auto& ride : rides) {
+        const auto& bus = *layout.routes[ride.route].bus;
+        for (size_t i = ride.first; i <= ride.last; ++i) {
+            if (!added[bus.stop_indexes[i]]) {
+                added[bus.stop_indexes[i]] = true;
+                stops.emplace_back(i, &bus);
+            }
+        }
+    }
+    for (const auto& [i, bus] : stops) {
+        doc.Add(MakeStopCircle(layout.points[bus->stop_indexes[i]]));
+    }
+    for (const auto& [i, bus] : stops) {
+        const svg::Point position = layout.points[bus->stop_indexes[i]];
+        doc.Add(MakeBaseStopText(styles_.stop_label_underlayer, position, bus->stops[i]));
+        doc.Add(MakeBaseStopText(styles_.stop_label, position, bus->stops[i]));
+    }
+    return doc;
+}
+
+// Линия и по две надписи на каждую конечную для маршрутов, круг и две надписи для остановок
+size_t MapRenderer::CountObjects(const MapLayout& layout) const {
+    size_t count = 3 * layout.stops.size();
+    for (const auto& route : layout.routes) {
+        count += 1 + 2 * route.final_stops.size();
+    }
+    return count;
+}
+
+std::string MapRenderer::RenderToString() const {
+    const auto& layout = GetLayout();
+    std::string out;
+    if (threads_ == 1 || CountObjects(layout) < PARALLEL_RENDER_MIN_OBJECTS) {
+        Render().Render(out);
+        return out;
+    }
+
+    // Элементы делятся на threads_ непрерывных частей примерно равной длины вывода;
+    // каждая часть строится и выводится в свой буфер, буферы склеиваются по порядку
+    std::vector<size_t> cost;
+    cost.reserve(GetItemCount(layout) + 1);
+    cost.push_back(0);
+    for (const auto& route : layout.routes) {
+        cost.push_back(cost.back() + LINE_COST + LINE_POINT_COST * route.bus->stop_indexes.size());
+    }
+    for (const auto& route : layout.routes) {
+        cost.push_back(cost.back() + 2 * TEXT_COST * route.final_stops.size());
+    }
+    for (size_t i = 0; i < layout.stops.size(); ++i) {
+        cost.push_back(cost.back() + CIRCLE_COST);
+    }
+    for (size_t i = 0; i < layout.stops.size(); ++i) {
+        cost.push_back(cost.back() + 2 * TEXT_COST);
+    }
+    std::vector<size_t> bounds{0};
+    for (size_t part = 1; part < threads_; ++part) {
+        const size_t target = cost.back() / threads_ * part;
+        bounds.push_back(std::lower_bound(cost.begin(), cost.end(), target) - cost.begin());
+    }
+    bounds.push_back(GetItemCount(layout));
+
+    std::vector<std::string> parts(threads_);
+    parallel::ForEachRange(threads_, threads_, [&](size_t begin, size_t end) {
+        for (size_t part = begin; part < end; ++part) {
+            svg::Document doc;
+            RenderItems(layout, bounds[part], bounds[part + 1], doc);
+            doc.RenderObjects(parts[part]);
+        }
+    });
+
+    size_t size = 0;
+    for (const auto& part : parts) {
+        size += part.size();
+    }
+    out.reserve(size + 128);
+    svg::Document header;
+    AddStyles(header);
+    header.RenderHeader(out);
+    for (const auto& part : parts) {
+        out += part;
+    }
+    svg::Document::RenderFooter(out);
+    return out;
+}
+
+const domain::RenderSettings& MapRenderer::GetSettings() const {
+    return settings_;
+}
+    
+// Цвета палитры назначаются маршрутам по кругу в порядке имён
+const svg::Color& MapRenderer::GetRouteColor(size_t route) const {
+    const auto& palette = settings_.color_palette;
+    return palette.empty() ? svg::DefaultColor : palette[route % palette.size()];
+}
+
+void MapRenderer::RenderRouteLines(const MapLayout& layout, size_t begin, size_t end, svg::Document& doc) const {
+    for (size_t r = begin; r < end; ++r) {
+        auto line = MakeRouteLine(GetRouteColor(r));
+        const auto& path = layout.routes[r].bus->stop_indexes;
+        if (settings_.simplify_tolerance > 0.) {
+            for (const size_t vertex : layout.routes[r].line_vertices) {
+                line.AddPoint(layout.points[path[vertex]]);
+            }
+        } else {
+            for (const size_t index : path) {
+                line.AddPoint(layout.points[index]);
+            }
+        }
+        doc.Add(std::move(line));
+    }
+}
+
+void MapRenderer::RenderBusLabels(const MapLayout& layout, size_t begin, size_t end, svg::Document& doc) const {
+    for (size_t r = begin; r < end; ++r) {
+        const auto& route = layout.routes[r];
+        for (const size_t stop : route.final_stops) {
+             auto text = MakeBaseBusText(styles_.bus_label, layout.points[stop], route.bus->id);
+             text.SetFillColor(GetRouteColor(r));
+             doc.Add(MakeBaseBusText(styles_.bus_label_underlayer, layout.points[stop], route.bus->id));
+             doc.Add(std::move(text));
         }
     }
 }
     
-void MapRenderer::RenderStops(const SphereProjector& projector, svg::Document& doc) const {
-    const auto& allstops = db_.GetStopIds();
-    for (const auto& stop : allstops) {
-        auto circle = std::make_unique<svg::Circle>();
-        circle->SetCenter(projector(db_.GetStop(stop)->place));
-        circle->SetRadius(settings_.stop_radius);
-        circle->SetFillColor(svg::Color {"white"sv});
-        doc.AddPtr(std::move(circle));
-    }
-    for (const auto& stop : allstops) {
-        auto text = MakeBaseStopText(stop, projector);
-        auto underlayer = MakeBaseStopText(stop, projector);
-        text->SetFillColor(svg::Color {"black"sv});
-        underlayer->SetFillColor(settings_.underlayer_color);
-        underlayer->SetStrokeColor(settings_.underlayer_color);
-        underlayer->SetStrokeWidth(settings_.underlayer_width);
-        underlayer->SetStrokeLineCap(StrokeLineCap::ROUND);
-        underlayer->SetStrokeLineJoin(StrokeLineJoin::ROUND);
-        doc.AddPtr(std::move(underlayer));
-        doc.AddPtr(std::move(text));
+void MapRenderer::RenderStopCircles(const MapLayout& layout, size_t begin, size_t end, svg::Document& doc) const {
+    for (size_t s = begin; s < end; ++s) {
+        doc.Add(MakeStopCircle(layout.points[layout.stops[s].second]));
+    }
+}
+
+void MapRenderer::RenderStopLabels(const MapLayout& layout, size_t begin, size_t end, svg::Document& doc) const {
+    for (size_t s = begin; s < end; ++s) {
+        const auto& [stop, index] = layout.stops[s];
+        doc.Add(MakeBaseStopText(styles_.stop_label_underlayer, layout.points[index], stop));
+        doc.Add(MakeBaseStopText(styles_.stop_label, layout.points[index], stop));
     }
 }
     
-std::unique_ptr<svg::Text> MapRenderer::MakeBaseBusText(const std::string_view& stop, const std::string_view& data, const SphereProjector& projector) const {
-    auto text = std::make_unique<svg::Text>();
-    text->SetPosition(projector(db_.GetStop(stop)->place));
-    text->SetOffset(settings_.bus_label_offset);
-    text->SetFontSize(settings_.bus_label_font_size);
-    text->SetFontFamily("Verdana"s);
-    text->SetFontWeight("bold"s);
-    text->SetData(std::string{data});
+svg::Polyline MapRenderer::MakeRouteLine(const svg::Color& color) const {
+    svg::Polyline line;
+    line.SetStyle(styles_.route_line);
+    line.SetStrokeColor(color);
+    return line;
+}
+
+svg::Circle MapRenderer::MakeStopCircle(svg::Point center) const {
+    svg::Circle circle;
+    circle.SetCenter(center);
+    circle.SetRadius(settings_.stop_radius);
+    circle.SetStyle(styles_.stop_circle);
+    return circle;
+}
+
+svg::Text MapRenderer::MakeBaseBusText(const svg::StylePtr& style, svg::Point position,
+                                       const std::string_view& data) const {
+    svg::Text text;
+    text.SetStyle(style);
+    text.SetPosition(position);
+    text.SetOffset(settings_.bus_label_offset);
+    text.SetFontSize(settings_.bus_label_font_size);
+    text.SetData(std::string{data});
     return text;
 }
     
-std::unique_ptr<svg::Text> MapRenderer::MakeBaseStopText(const std::string_view& stop,  const SphereProjector& projector) const {
-    auto text = std::make_unique<svg::Text>();
-    text->SetPosition(projector(db_.GetStop(stop)->place));
-    text->SetOffset(settings_.stop_label_offset);
-    text->SetFontSize(settings_.stop_label_font_size);
-    text->SetFontFamily("Verdana"s);
-    text->SetData(std::string{stop});
+svg::Text MapRenderer::MakeBaseStopText(const svg::StylePtr& style, svg::Point position,
+                                        const std::string_view& stop) const {
+    svg::Text text;
+    text.SetStyle(style);
+    text.SetPosition(position);
+    text.SetOffset(settings_.stop_label_offset);
+    text.SetFontSize(settings_.stop_label_font_size);
+    text.SetData(std::string{stop});
     return text;
 }
 
+std::shared_ptr<const std::string> MapCache::Get(uint64_t version, const MapRenderer& renderer) {
+    const auto& settings = renderer.GetSettings();
+    const std::pair key{version, HashSettings(settings)};
+    std::lock_guard guard(mutex_);
+    const auto [begin, end] = maps_.equal_range(key);
+    for (auto it = begin; it != end; ++it) {
+        if (it->second.settings == settings) {
+            return it->second.map;
+        }
+    }
+    // карты устаревших версий больше не понадобятся
+    maps_.erase(maps_.begin(), maps_.lower_bound(std::pair{version, size_t{0}}));
+    // экранируется один раз здесь, ответы выводят готовую строку без просмотра
+    std::string text = renderer.RenderToString();
+    text.insert(text.begin(), '"');
+    json::EscapeString(text, 1);
+    text += '"';
+    auto map = std::make_shared<const std::string>(std::move(text));
+    maps_.emplace(key, Entry{settings, map});
+    return map;
+}
+
 }
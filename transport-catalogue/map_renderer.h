@@ -5,9 +5,15 @@
 #include "transport_catalogue.h"
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <optional>
+#include <string>
+#include <utility>
 #include <vector>
 #include <memory>
 #include <cassert>
@@ -19,6 +25,8 @@ namespace renderer {
 inline const double EPSILON = 1e-6;
 bool IsZero(double value);
 
+size_t HashSettings(const domain::RenderSettings& settings);
+
 class SphereProjector {
 public:
     template <typename PointInputIt>
@@ -76,17 +84,138 @@ private:
     double zoom_coeff_ = 0;
 };
     
+// Всё, что нужно слоям карты от справочника, посчитанное один раз
+struct MapLayout {
+    struct Route {
+        const transport::BusDescription* bus;
+        // StopDescription::index конечных, в порядке final_stops
+        std::vector<size_t> final_stops;
+        // При упрощении линий - номера вершин stop_indexes, оставшихся в линии маршрута
+        std::vector<size_t> line_vertices;
+    };
+
+    // экранные точки по StopDescription::index; заполнены только для остановок с маршрутами
+    std::vector<svg::Point> points;
+    // остановки с маршрутами по возрастанию имени: имя и StopDescription::index
+    std::vector<std::pair<std::string_view, size_t>> stops;
+    // непустые маршруты по возрастанию имени
+    std::vector<Route> routes;
+};
+
+// Отрезки маршрутов и остановки MapLayout в равномерной сетке над плоскостью карты,
+// чтобы плитка просматривала только то, что лежит рядом с ней
+struct TileIndex {
+    // Отрезки маршрута layout.routes[r] имеют номера [segment_offsets[r], segment_offsets[r + 1]),
+    // отрезок номер segment_offsets[r] + i соединяет вершины i и i + 1 маршрута
+    std::vector<size_t> segment_offsets;
+    // Надписи маршрута r - по одной на конечную, номера [label_offsets[r], label_offsets[r + 1])
+    std::vector<size_t> label_offsets;
+    // CSR: номера надписей маршрутов у остановки layout.stops[s]
+    // лежат в stop_labels на отрезке [stop_label_offsets[s], stop_label_offsets[s + 1])
+    std::vector<size_t> stop_label_offsets;
+    std::vector<size_t> stop_labels;
+    // Наибольшее удаление края надписи от её остановки, в пикселях плитки
+    double label_reach = 0.;
+
+    double cell_width = 1.;
+    double cell_height = 1.;
+    int rows = 0;
+    int columns = 0;
+    // CSR: клетка (row, column) - на отрезке [cell_offsets[row * columns + column], ...[+ 1]) в items;
+    // элемент меньше segment_offsets.back() - номер отрезка, иначе остановка
+    // layout.stops[item - segment_offsets.back()]
+    std::vector<size_t> cell_offsets;
+    std::vector<size_t> items;
+};
+
+// Плитки масштаба zoom делят карту на 2^zoom x 2^zoom равных частей
+inline const int MAX_TILE_ZOOM = 20;
+
 class MapRenderer {
 public:
-    MapRenderer(const domain::RenderSettings& settings, const transport::TransportCatalogue& db);
+    // threads - сколько потоков может занять RenderToString. Если log не nullptr,
+    // при упрощении линий туда выводится число вершин до и после
+    MapRenderer(const domain::RenderSettings& settings, const transport::TransportCatalogue& db, size_t threads = 1,
+                std::ostream* log = nullptr);
     const svg::Document Render() const;
+    // Карта в виде текста SVG. Большая карта делится на части, каждая строится и выводится
+    // в своём потоке; результат не зависит от числа потоков
+    std::string RenderToString() const;
+    const domain::RenderSettings& GetSettings() const;
+    // Проекция строится при первом вызове и используется всеми следующими картами
+    // этого визуализатора: справочник и настройки, на которые он ссылается, не меняются
+    const MapLayout& GetLayout() const;
+
+    bool HasTile(int zoom, int x, int y) const;
+    // Плитка в столбце x и строке y масштаба zoom, растянутая до размеров всей карты.
+    // Выводятся только части маршрутов, остановки и надписи, которые её задевают, в том же
+    // порядке слоёв, что у Render; толщины линий, радиусы и шрифты не масштабируются,
+    // линии не упрощаются. Требует HasTile(zoom, x, y)
+    svg::Document RenderTile(int zoom, int x, int y) const;
+    std::string RenderTileToString(int zoom, int x, int y) const;
+
+    // Поездки пути path для вывода поверх карты Render: участки маршрутов от посадки
+    // до высадки, надписи маршрутов у посадки и высадки, остановки поездок и их названия,
+    // в том же порядке слоёв. Проекция та же, что у карты
+    svg::Document RenderRoute(const transport::PathDescription& path) const;
 private:
-    void RenderRoutes(const SphereProjector& projector, svg::Document& doc) const;
-    void RenderStops(const SphereProjector& projector, svg::Document& doc) const;
-    std::unique_ptr<svg::Text> MakeBaseBusText(const std::string_view& stop, const std::string_view& data, const SphereProjector& projector) const;
-    std::unique_ptr<svg::Text> MakeBaseStopText(const std::string_view& stop,  const SphereProjector& projector) const;
+    MapLayout MakeLayout() const;
+    void SimplifyLines(MapLayout& layout) const;
+    const TileIndex& GetTileIndex() const;
+    TileIndex MakeTileIndex() const;
+    size_t CountObjects(const MapLayout& layout) const;
+    size_t GetItemCount(const MapLayout& layout) const;
+    void RenderItems(const MapLayout& layout, size_t begin, size_t end, svg::Document& doc) const;
+    const svg::Color& GetRouteColor(size_t route) const;
+    void RenderRouteLines(const MapLayout& layout, size_t begin, size_t end, svg::Document& doc) const;
+    void RenderBusLabels(const MapLayout& layout, size_t begin, size_t end, svg::Document& doc) const;
+    void RenderStopCircles(const MapLayout& layout, size_t begin, size_t end, svg::Document& doc) const;
+    void RenderStopLabels(const MapLayout& layout, size_t begin, size_t end, svg::Document& doc) const;
+    void AddStyles(svg::Document& doc) const;
+    svg::Polyline MakeRouteLine(const svg::Color& color) const;
+    svg::Circle MakeStopCircle(svg::Point center) const;
+    svg::Text MakeBaseBusText(const svg::StylePtr& style, svg::Point position, const std::string_view& data) const;
+    svg::Text MakeBaseStopText(const svg::StylePtr& style, svg::Point position, const std::string_view& stop) const;
+
+    // Оформление слоёв карты, одно на все объекты слоя; собственные у объектов
+    // только положение, текст и цвет маршрута
+    struct Styles {
+        svg::StylePtr route_line;
+        svg::StylePtr bus_label;
+        svg::StylePtr bus_label_underlayer;
+        svg::StylePtr stop_circle;
+        svg::StylePtr stop_label;
+        svg::StylePtr stop_label_underlayer;
+    };
+    static Styles MakeStyles(const domain::RenderSettings& settings);
+
     const domain::RenderSettings& settings_;
     const transport::TransportCatalogue& db_;
+    const size_t threads_;
+    std::ostream* const log_;
+    const Styles styles_;
+    mutable std::once_flag layout_flag_;
+    mutable MapLayout layout_;
+    mutable std::once_flag tile_index_flag_;
+    mutable TileIndex tile_index_;
 };
     
+// Готовые SVG карты, общие для всех запросов Map, записанные строкой JSON - в кавычках
+// и с экранированием, как их выводит json::Writer.
+// Ключ - версия справочника и хеш настроек отрисовки, совпадение настроек
+// дополнительно проверяется сравнением. Карта строится один раз на ключ;
+// когда запрошена более новая версия справочника, карты старых версий удаляются
+class MapCache {
+public:
+    std::shared_ptr<const std::string> Get(uint64_t version, const MapRenderer& renderer);
+private:
+    struct Entry {
+        domain::RenderSettings settings;
+        std::shared_ptr<const std::string> map;
+    };
+
+    std::mutex mutex_;
+    std::multimap<std::pair<uint64_t, size_t>, Entry> maps_;
+};
+
 }
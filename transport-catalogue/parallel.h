@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+inline size_t GetThreadCount() {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+// Делит [0, count) на не больше threads непрерывных отрезков одинаковой длины
+// и вызывает func(begin, end) для каждого в отдельном потоке. Первый отрезок
+// обрабатывается в вызывающем потоке. Исключение из любого отрезка
+// пробрасывается после завершения всех потоков.
+template <typename Func>
+void ForEachRange(size_t count, size_t threads, Func func) {
+    threads = std::clamp<size_t>(threads, 1, std::max<size_t>(count, 1));
+    if (threads == 1) {
+        func(size_t {0}, count);
+        return;
+    }
+    const size_t step = (count + threads - 1) / threads;
+    std::vector<std::future<void>> tasks;
+    tasks.reserve(threads - 1);
+    for (size_t begin = step; begin < count; begin += step) {
+        tasks.push_back(std::async(std::launch::async, func, begin, std::min(begin + step, count)));
+    }
+    std::exception_ptr error;
+    try {
+        func(size_t {0}, std::min(step, count));
+    } catch (...) {
+        error = std::current_exception();
+    }
+    for (auto& task : tasks) {
+        try {
+            task.get();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}  // namespace parallel
@@ -1,16 +1,34 @@
 #include "request_handler.h"
 #include "domain.h"
-#include "json_builder.h"
+#include "json_writer.h"
+#include "log_duration.h"
+#include "parallel.h"
 
-#include <sstream>
+#include <utility>
 
 using namespace transport;
 using namespace handler;
 using namespace json;
 using namespace domain;
 
+namespace {
 
-RequestHandler::RequestHandler(const TransportCatalogue& db, const renderer::MapRenderer& renderer, const router::TransportRouter& router) : db_(db), renderer_(renderer), router_(router) {
+// Конец карты из MapCache: закрывающий тег SVG и кавычка строки JSON
+std::string_view GetMapFooter() {
+    static const std::string footer = [] {
+        std::string text;
+        svg::Document::RenderFooter(text);
+        json::EscapeString(text);
+        return text + '"';
+    }();
+    return footer;
+}
+
+}  // namespace
+
+RequestHandler::RequestHandler(const TransportCatalogue& db, const renderer::MapRenderer& renderer, const router::TransportRouter& router,
+                               uint64_t version, std::shared_ptr<renderer::MapCache> map_cache)
+    : db_(db), renderer_(renderer), router_(router), version_(version), map_cache_(std::move(map_cache)) {
 }
 
 std::optional<RouteStatistics> RequestHandler::GetBusStat(const std::string_view& bus_name) const {
@@ -18,7 +36,7 @@ std::optional<RouteStatistics> RequestHandler::GetBusStat(const std::string_view
     return db_.GetStat(bus);    
 }
 
-const std::set<BusPtr>* RequestHandler::GetBusesByStop(const std::string_view& stop_name) const {
+std::optional<BusRange> RequestHandler::GetBusesByStop(const std::string_view& stop_name) const {
     return db_.GetBusses4Stop(stop_name);    
 }
 
@@ -26,88 +44,196 @@ const svg::Document RequestHandler::RenderMap() const {
     return renderer_.Render();
 }
 
+std::shared_ptr<const std::string> RequestHandler::GetMap() const {
+    return map_cache_->Get(version_, renderer_);
+}
+
 
-json::Document RequestHandler::ApplyCommands(const domain::Commands& commands) const {
-    json::Builder ans;
+void RequestHandler::ApplyCommands(const domain::Commands& commands, json::Writer& ans) const {
     ans.StartArray();
     for (const auto& cmd : commands.stat_requests) {
-        ans.StartDict();
-        switch (cmd.type) {
-            case StatType::Bus: {
-                const auto bus = db_.GetBus(cmd.name);
-                const auto stat = db_.GetStat(bus);
-                ans.Key("request_id").Value(cmd.id);
-                if (!stat) {
-                    ans.Key("error_message").Value("not found");
-                } else {
-                    ans.Key("curvature").Value(stat->curvature)
-                       .Key("route_length").Value(stat->dist)
-                       .Key("stop_count").Value(static_cast<int>(stat->stops_count))
-                       .Key("unique_stop_count").Value(static_cast<int>(stat->unique_stops));
-                }
-                break;
+        ApplyCommand(cmd, ans);
+    }
+    ans.EndArray();
+}
+
+std::optional<transport::PathDescription> RequestHandler::FindPath(const domain::StatRequest& cmd) const {
+    // маршрутизатор знает только остановки справочника
+    if (!db_.GetStop(cmd.from) || !db_.GetStop(cmd.to)) {
+        return std::nullopt;
+    }
+    return router_.GetPath(cmd.from, cmd.to);
+}
+
+// Ключи выводятся по алфавиту - в том порядке, в каком Print выводит json::Dict
+void RequestHandler::ApplyCommand(const domain::StatRequest& cmd, json::Writer& ans) const {
+    ans.StartDict();
+    switch (cmd.type) {
+        case StatType::Bus: {
+            const auto bus = db_.GetBus(cmd.name);
+            const auto stat = db_.GetStat(bus);
+            if (!stat) {
+                ans.Key("error_message").Value("not found")
+                   .Key("request_id").Value(cmd.id);
+            } else {
+                ans.Key("curvature").Value(stat->curvature)
+                   .Key("request_id").Value(cmd.id)
+                   .Key("route_length").Value(stat->dist)
+                   .Key("stop_count").Value(static_cast<int>(stat->stops_count))
+                   .Key("unique_stop_count").Value(static_cast<int>(stat->unique_stops));
             }
-            case StatType::Stop: {
-                const auto buses4stop = db_.GetBusses4Stop(cmd.name);
-                ans.Key("request_id").Value(cmd.id);
-                if (!buses4stop) {
-                    ans.Key("error_message").Value("not found");
-                } else {
-                    ans.Key("buses").StartArray();
-                    for (const auto& bus : *buses4stop) {
-                        ans.Value(std::string(bus));
-                    }
-                    ans.EndArray();
+            break;
+        }
+        case StatType::Stop: {
+            const auto buses4stop = db_.GetBusses4Stop(cmd.name);
+            if (!buses4stop) {
+                ans.Key("error_message").Value("not found");
+            } else {
+                ans.Key("buses").StartArray();
+                for (const auto& bus : *buses4stop) {
+                    ans.Value(bus);
                 }
-                break;
+                ans.EndArray();
             }
-            case StatType::Map: {
-                const auto& doc = RenderMap();
-                std::stringstream map;
-                doc.Render(map);
-                ans.Key("request_id").Value(cmd.id)
-                   .Key("map").Value(map.str());
-                break;
+            ans.Key("request_id").Value(cmd.id);
+            break;
+        }
+        case StatType::Map: {
+            ans.Key("map").RawValue(*GetMap())
+               .Key("request_id").Value(cmd.id);
+            break;
+        }
+        case StatType::MapTile: {
+            if (!renderer_.HasTile(cmd.zoom, cmd.x, cmd.y)) {
+                ans.Key("error_message").Value("not found")
+                   .Key("request_id").Value(cmd.id);
+            } else {
+                // плитка выводится сразу в буфер ответа
+                const auto render_tile = [&](std::string& out) {
+                    renderer_.RenderTile(cmd.zoom, cmd.x, cmd.y).Render(out);
+                };
+                ans.Key("map").StringValue(render_tile)
+                   .Key("request_id").Value(cmd.id);
+            }
+            break;
+        }
+        case StatType::RouteMap: {
+            const auto path = FindPath(cmd);
+            if (path) {
+                // поездки дописываются к готовой карте перед закрывающим тегом
+                const auto map = GetMap();
+                const std::string_view footer = GetMapFooter();
+                std::string rides;
+                renderer_.RenderRoute(*path).RenderObjects(rides);
+                json::EscapeString(rides);
+                ans.Key("map").RawValue({std::string_view(*map).substr(0, map->size() - footer.size()), rides, footer})
+                   .Key("request_id").Value(cmd.id);
+            } else {
+                ans.Key("error_message").Value("not found")
+                   .Key("request_id").Value(cmd.id);
             }
-            case StatType::Route: {
-                auto path = router_.GetPath(cmd.from, cmd.to);
-                if (path) {
-                    ans.Key("request_id").Value(cmd.id)
-                       .Key("total_time").Value(path->time)
-                       .Key("items").StartArray();
-                    for (const auto& d : path->route) {
-                        if (d.type == transport::PathType::Wait) {
-                            ans.StartDict()
-                               .Key("type").Value("Wait")
-                               .Key("stop_name").Value(std::string(d.id))
-                               .Key("time").Value(d.time)
-                               .EndDict();
-                        } else if (d.type == transport::PathType::Bus) {
-                            ans.StartDict()
-                               .Key("type").Value("Bus")
-                               .Key("bus").Value(std::string(d.id))
-                               .Key("span_count").Value(d.span.value())
-                               .Key("time").Value(d.time)
-                               .EndDict();
-                        }
+            break;
+        }
+        case StatType::Route: {
+            const auto path = FindPath(cmd);
+            if (path) {
+                ans.Key("items").StartArray();
+                for (const auto& d : path->route) {
+                    if (d.type == transport::PathType::Wait) {
+                        ans.StartDict()
+                           .Key("stop_name").Value(d.id)
+                           .Key("time").Value(d.time)
+                           .Key("type").Value("Wait")
+                           .EndDict();
+                    } else if (d.type == transport::PathType::Bus) {
+                        ans.StartDict()
+                           .Key("bus").Value(d.id)
+                           .Key("span_count").Value(d.span.value())
+                           .Key("time").Value(d.time)
+                           .Key("type").Value("Bus")
+                           .EndDict();
                     }
-                    ans.EndArray();
-                } else {
-                    ans.Key("request_id").Value(cmd.id)
-                       .Key("error_message").Value("not found");
                 }
-                break;
+                ans.EndArray()
+                   .Key("request_id").Value(cmd.id)
+                   .Key("total_time").Value(path->time);
+            } else {
+                ans.Key("error_message").Value("not found")
+                   .Key("request_id").Value(cmd.id);
+            }
+            break;
+        }
+        case StatType::NearestStops: {
+            const size_t count = !cmd.count ? transport::TransportCatalogue::NO_LIMIT
+                               : *cmd.count > 0 ? static_cast<size_t>(*cmd.count) : 0;
+            ans.Key("request_id").Value(cmd.id)
+               .Key("stops").StartArray();
+            for (const auto& stop : db_.GetNearestStops(cmd.place, cmd.radius, count)) {
+                ans.StartDict()
+                   .Key("distance").Value(stop.distance)
+                   .Key("stop_name").Value(stop.id)
+                   .EndDict();
             }
+            ans.EndArray();
+            break;
         }
-        ans.EndDict();
     }
-    return Document(ans.EndArray().Build());
+    ans.EndDict();
 }
 
 CatalogueConstructor::CatalogueConstructor(transport::TransportCatalogue& db, const domain::RoutingSettings& settings) : db_(db), settings_(settings) {
 }
 
 void CatalogueConstructor::FillFromCommands(const domain::Commands& commands) {
+    AddFromCommands(commands);
+    Finish();
+}
+
+void CatalogueConstructor::BulkFillFromCommands(const domain::Commands& commands, size_t threads, std::ostream* timings) {
+    using namespace std::literals;
+    const auto& stops = commands.stop_requests;
+    const auto& buses = commands.bus_requests;
+    {
+        LogDuration guard("stops"s, timings);
+        db_.Reserve(stops.size(), buses.size());
+        for (const auto& cmd : stops) {
+            db_.AddStop(cmd.name, cmd.place);
+        }
+    }
+    {
+        LogDuration guard("distances"s, timings);
+        // Каждая остановка записывается одним потоком, только если у неё одна команда;
+        // для повторяющихся имён порядок команд сохраняется последовательной загрузкой
+        const size_t distances_threads = db_.GetStopsCount() == stops.size() ? threads : 1;
+        parallel::ForEachRange(stops.size(), distances_threads, [this, &stops](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                db_.AddDistances(stops[i].name, stops[i].road_distances);
+            }
+        });
+    }
+    {
+        LogDuration guard("buses"s, timings);
+        std::vector<transport::BusDescription> descriptions(buses.size());
+        parallel::ForEachRange(buses.size(), threads, [this, &buses, &descriptions](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                descriptions[i] = db_.MakeBus(buses[i].name, buses[i].stops, buses[i].final_stops);
+            }
+        });
+        for (auto& bus : descriptions) {
+            db_.AddBus(std::move(bus));
+        }
+    }
+    {
+        LogDuration guard("graph"s, timings);
+        db_.BuildMapGraph(settings_.bus_velocity, settings_.bus_wait_time, threads);
+    }
+    {
+        LogDuration guard("indexes"s, timings);
+        db_.BuildIndexes();
+    }
+}
+
+void CatalogueConstructor::AddFromCommands(const domain::Commands& commands) {
     for (const auto& cmd : commands.stop_requests) {
         db_.AddStop(cmd.name, cmd.place);        
     }
@@ -119,5 +245,9 @@ void CatalogueConstructor::FillFromCommands(const domain::Commands& commands) {
     for (const auto& cmd : commands.bus_requests) {
         db_.AddBus(cmd.name, cmd.stops, cmd.final_stops);        
     }
+}
+
+void CatalogueConstructor::Finish() {
     db_.BuildMapGraph(settings_.bus_velocity, settings_.bus_wait_time);
+    db_.BuildIndexes();
 }
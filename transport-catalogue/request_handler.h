@@ -4,6 +4,11 @@
 #include "map_renderer.h"
 #include "transport_router.h"
 #include "json.h"
+#include "json_writer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
 
 namespace handler {
     
@@ -11,6 +16,15 @@ class CatalogueConstructor {
 public:
     CatalogueConstructor(transport::TransportCatalogue& db, const domain::RoutingSettings& settings);
     void FillFromCommands(const domain::Commands& commands);
+    // Загрузка в пустой справочник: контейнеры заранее получают нужный размер,
+    // расстояния, маршруты и рёбра графа строятся в threads потоках.
+    // Результат не зависит от числа потоков. Если timings не nullptr,
+    // туда выводится длительность каждого этапа.
+    void BulkFillFromCommands(const domain::Commands& commands, size_t threads, std::ostream* timings = nullptr);
+    // Только добавляет остановки, расстояния и маршруты, без построения графа и индексов
+    void AddFromCommands(const domain::Commands& commands);
+    // Строит граф и индексы по уже добавленным данным
+    void Finish();
 private:
     transport::TransportCatalogue& db_;
     const domain::RoutingSettings& settings_;
@@ -18,25 +32,40 @@ private:
 
 class RequestHandler {
 public:
-    // MapRenderer понадобится в следующей части итогового проекта
-    RequestHandler(const transport::TransportCatalogue& db, const renderer::MapRenderer& renderer, const router::TransportRouter& router);
+    // version - версия справочника db для кэша карт; кэш можно разделить
+    // между обработчиками, иначе у обработчика свой
+    RequestHandler(const transport::TransportCatalogue& db, const renderer::MapRenderer& renderer, const router::TransportRouter& router,
+                   uint64_t version = 0, std::shared_ptr<renderer::MapCache> map_cache = std::make_shared<renderer::MapCache>());
 
     // Возвращает информацию о маршруте (запрос Bus)
     std::optional<transport::RouteStatistics> GetBusStat(const std::string_view& bus_name) const;
 
     // Возвращает маршруты, проходящие через
-    const std::set<transport::BusPtr>* GetBusesByStop(const std::string_view& stop_name) const;
+    std::optional<transport::BusRange> GetBusesByStop(const std::string_view& stop_name) const;
 
     // Этот метод будет нужен в следующей части итогового проекта
     const svg::Document RenderMap() const;
+
+    // Текст SVG карты строкой JSON (см. MapCache), строится один раз на версию
+    // справочника и настройки отрисовки
+    std::shared_ptr<const std::string> GetMap() const;
     
-    json::Document ApplyCommands(const domain::Commands& commands) const;
+    // Ответы выводятся в ans по мере вычисления, массивом в порядке запросов
+    void ApplyCommands(const domain::Commands& commands, json::Writer& ans) const;
+
+    // Ответ на один запрос, словарь из того же элемента, что в ApplyCommands
+    void ApplyCommand(const domain::StatRequest& command, json::Writer& ans) const;
 
 private:
+    // Путь для запросов Route и RouteMap, nullopt и для неизвестных остановок
+    std::optional<transport::PathDescription> FindPath(const domain::StatRequest& cmd) const;
+
     // RequestHandler использует агрегацию объектов "Транспортный Справочник" и "Визуализатор Карты"
     const transport::TransportCatalogue& db_;
     const renderer::MapRenderer& renderer_;
     const router::TransportRouter& router_;
+    const uint64_t version_;
+    const std::shared_ptr<renderer::MapCache> map_cache_;
 };
     
 }
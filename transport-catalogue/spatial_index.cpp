@@ -0,0 +1,139 @@
+#define _USE_MATH_DEFINES
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace geo {
+
+namespace {
+
+const double METERS_IN_DEGREE = EarthRadius * M_PI / 180.0;
+const size_t ITEMS_PER_CELL = 2;
+const int MAX_GRID_SIDE = 4096;
+
+bool CloserThan(const Neighbour& lhs, const Neighbour& rhs) {
+    return lhs.distance < rhs.distance || (lhs.distance == rhs.distance && lhs.id < rhs.id);
+}
+
+}  // namespace
+
+GridIndex::GridIndex(const std::vector<Coordinates>& points) {
+    if (points.empty()) {
+        return;
+    }
+    const auto [bottom_it, top_it] = std::minmax_element(points.begin(), points.end(),
+        [](const Coordinates& lhs, const Coordinates& rhs) { return lhs.lat < rhs.lat; });
+    const auto [left_it, right_it] = std::minmax_element(points.begin(), points.end(),
+        [](const Coordinates& lhs, const Coordinates& rhs) { return lhs.lng < rhs.lng; });
+    min_lat_ = bottom_it->lat;
+    min_lng_ = left_it->lng;
+    const double lat_span = top_it->lat - min_lat_;
+    const double lng_span = right_it->lng - min_lng_;
+
+    // Клетки примерно квадратные в метрах, в среднем по ITEMS_PER_CELL точек на клетку
+    const double max_abs_lat = std::max(std::abs(bottom_it->lat), std::abs(top_it->lat));
+    const double lng_scale = std::max(std::cos(max_abs_lat * M_PI / 180.0), 1e-6);
+    const double height = lat_span * METERS_IN_DEGREE;
+    const double width = lng_span * METERS_IN_DEGREE * std::cos((min_lat_ + lat_span / 2) * M_PI / 180.0);
+    const double cells = std::max<double>(1., static_cast<double>(points.size() / ITEMS_PER_CELL));
+    const double area = std::max(height, 1.) * std::max(width, 1.);
+    const double cell_size = std::max(std::sqrt(area / cells), 1.);
+    rows_ = std::clamp(static_cast<int>(height / cell_size) + 1, 1, MAX_GRID_SIDE);
+    columns_ = std::clamp(static_cast<int>(width / cell_size) + 1, 1, MAX_GRID_SIDE);
+    lat_step_ = lat_span > 0. ? lat_span / rows_ : 1.;
+    lng_step_ = lng_span > 0. ? lng_span / columns_ : 1.;
+    min_cell_size_ = std::min(lat_step_ * METERS_IN_DEGREE, lng_step_ * METERS_IN_DEGREE * lng_scale);
+
+    std::vector<size_t> cell_of(points.size());
+    offsets_.assign(static_cast<size_t>(rows_) * columns_ + 1, 0);
+    for (size_t id = 0; id < points.size(); ++id) {
+        cell_of[id] = static_cast<size_t>(GetRow(points[id].lat)) * columns_ + GetColumn(points[id].lng);
+        ++offsets_[cell_of[id] + 1];
+    }
+    for (size_t cell = 1; cell < offsets_.size(); ++cell) {
+        offsets_[cell] += offsets_[cell - 1];
+    }
+    items_.resize(points.size());
+    std::vector<size_t> fill(offsets_.begin(), offsets_.end() - 1);
+    for (size_t id = 0; id < points.size(); ++id) {
+        items_[fill[cell_of[id]]++] = {points[id], id};
+    }
+}
+
+int GridIndex::GetRow(double lat) const {
+    return std::clamp(static_cast<int>(std::floor((lat - min_lat_) / lat_step_)), 0, rows_ - 1);
+}
+
+int GridIndex::GetColumn(double lng) const {
+    return std::clamp(static_cast<int>(std::floor((lng - min_lng_) / lng_step_)), 0, columns_ - 1);
+}
+
+template <typename Visitor>
+void GridIndex::VisitRing(int row, int column, int ring, Visitor&& visit) const {
+    const auto visit_cell = [this, &visit](int r, int c) {
+        const size_t cell = static_cast<size_t>(r) * columns_ + c;
+        for (size_t i = offsets_[cell]; i < offsets_[cell + 1]; ++i) {
+            visit(items_[i]);
+        }
+    };
+    for (int r = std::max(row - ring, 0); r <= std::min(row + ring, rows_ - 1); ++r) {
+        if (r == row - ring || r == row + ring) {
+            for (int c = std::max(column - ring, 0); c <= std::min(column + ring, columns_ - 1); ++c) {
+                visit_cell(r, c);
+            }
+            continue;
+        }
+        if (column - ring >= 0) {
+            visit_cell(r, column - ring);
+        }
+        if (column + ring < columns_) {
+            visit_cell(r, column + ring);
+        }
+    }
+}
+
+std::vector<Neighbour> GridIndex::FindNearest(Coordinates center, double radius, size_t count) const {
+    std::vector<Neighbour> heap;
+    if (items_.empty() || count == 0 || radius < 0.) {
+        return heap;
+    }
+    heap.reserve(std::min(count, items_.size()));
+
+    // Клетка точки запроса; если точка вне сетки - ближайшая к ней клетка края,
+    // оценка расстояния до колец при этом остаётся оценкой снизу
+    const int row = GetRow(center.lat);
+    const int column = GetColumn(center.lng);
+    const int max_ring = std::max(std::max(row, rows_ - 1 - row), std::max(column, columns_ - 1 - column));
+
+    for (int ring = 0; ring <= max_ring; ++ring) {
+        // Все точки кольца ring удалены от центра не меньше чем на (ring - 1) клеток
+        const double ring_distance = (ring - 1) * min_cell_size_;
+        if (ring_distance > radius || (heap.size() == count && ring_distance > heap.front().distance)) {
+            break;
+        }
+        VisitRing(row, column, ring, [&](const Item& item) {
+            double distance = item.place == center ? 0. : ComputeDistance(center, item.place);
+            if (std::isnan(distance)) {
+                // acos от аргумента чуть больше единицы для совпадающих точек
+                distance = 0.;
+            }
+            if (distance > radius) {
+                return;
+            }
+            const Neighbour candidate {item.id, distance};
+            if (heap.size() < count) {
+                heap.push_back(candidate);
+                std::push_heap(heap.begin(), heap.end(), CloserThan);
+            } else if (CloserThan(candidate, heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), CloserThan);
+                heap.back() = candidate;
+                std::push_heap(heap.begin(), heap.end(), CloserThan);
+            }
+        });
+    }
+    std::sort_heap(heap.begin(), heap.end(), CloserThan);
+    return heap;
+}
+
+}  // namespace geo
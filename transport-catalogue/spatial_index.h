@@ -0,0 +1,53 @@
+#pragma once
+
+#include "geo.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace geo {
+
+struct Neighbour {
+    size_t id;
+    double distance;
+};
+
+// Равномерная сетка над точками на сфере. Строится один раз по всем точкам,
+// после чего отвечает на запросы ближайших соседей, просматривая только
+// клетки вокруг точки запроса.
+class GridIndex {
+public:
+    GridIndex() = default;
+    // id точки - её позиция в points
+    explicit GridIndex(const std::vector<Coordinates>& points);
+
+    // Не более count ближайших к center точек на расстоянии не больше radius метров,
+    // упорядоченные по возрастанию расстояния
+    std::vector<Neighbour> FindNearest(Coordinates center, double radius, size_t count) const;
+
+private:
+    struct Item {
+        Coordinates place;
+        size_t id;
+    };
+
+    int GetRow(double lat) const;
+    int GetColumn(double lng) const;
+    template <typename Visitor>
+    void VisitRing(int row, int column, int ring, Visitor&& visit) const;
+
+    double min_lat_ = 0.;
+    double min_lng_ = 0.;
+    double lat_step_ = 1.;
+    double lng_step_ = 1.;
+    int rows_ = 0;
+    int columns_ = 0;
+    // нижняя оценка размера клетки в метрах, по ней прекращается обход колец
+    double min_cell_size_ = 0.;
+    // CSR: точки клетки (row, column) лежат в items_
+    // на отрезке [offsets_[row * columns_ + column], offsets_[row * columns_ + column + 1])
+    std::vector<size_t> offsets_;
+    std::vector<Item> items_;
+};
+
+}  // namespace geo
@@ -1,7 +1,9 @@
 #include "svg.h"
 
 #define _USE_MATH_DEFINES 
+#include <charconv>
 #include <cmath>
+#include <memory>
 
 using namespace std;
 
@@ -20,6 +22,79 @@ namespace {
     }
     return polyline.SetFillColor("red"s).SetStrokeColor("black"s);
 }
+
+// general с точностью 6 даёт ту же запись, что operator<< для double
+void WriteNumber(std::string& out, double value) {
+    char chars[32];
+    const auto result = to_chars(begin(chars), end(chars), value, chars_format::general, 6);
+    out.append(chars, result.ptr);
+}
+
+void WriteNumber(std::string& out, uint32_t value) {
+    char chars[16];
+    const auto result = to_chars(begin(chars), end(chars), value);
+    out.append(chars, result.ptr);
+}
+
+std::string_view ToString(svg::StrokeLineCap cap) {
+    using svg::StrokeLineCap;
+    switch(cap) {
+        case StrokeLineCap::BUTT : return "butt"sv;
+        case StrokeLineCap::ROUND : return "round"sv;
+        case StrokeLineCap::SQUARE : return "square"sv;
+    }
+    return {};
+}
+
+std::string_view ToString(svg::StrokeLineJoin join) {
+    using svg::StrokeLineJoin;
+    switch(join) {
+        case StrokeLineJoin::ARCS : return "arcs"sv;
+        case StrokeLineJoin::BEVEL : return "bevel"sv;
+        case StrokeLineJoin::MITER : return "miter"sv;
+        case StrokeLineJoin::MITER_CLIP : return "miter-clip"sv;
+        case StrokeLineJoin::ROUND : return "round"sv;
+    }
+    return {};
+}
+
+// .имя { свойство: значение; ... } - те же свойства, что у атрибутов
+void WriteStyleClass(std::string& out, const svg::Style& style) {
+    const auto property = [&out](std::string_view name, std::string_view value) {
+        out += ' ';
+        out += name;
+        out += ": "sv;
+        out += value;
+        out += ';';
+    };
+    out += "    ."sv;
+    out += style.class_name;
+    out += " {"sv;
+    if (style.fill) {
+        property("fill"sv, *style.fill);
+    }
+    if (style.stroke) {
+        property("stroke"sv, *style.stroke);
+    }
+    if (style.stroke_width) {
+        out += " stroke-width: "sv;
+        WriteNumber(out, *style.stroke_width);
+        out += ';';
+    }
+    if (style.stroke_linecap) {
+        property("stroke-linecap"sv, ToString(*style.stroke_linecap));
+    }
+    if (style.stroke_linejoin) {
+        property("stroke-linejoin"sv, ToString(*style.stroke_linejoin));
+    }
+    if (!style.font_family.empty()) {
+        property("font-family"sv, style.font_family);
+    }
+    if (!style.font_weight.empty()) {
+        property("font-weight"sv, style.font_weight);
+    }
+    out += " }\n"sv;
+}
 }
 
 namespace svg {
@@ -31,27 +106,12 @@ using namespace std::literals;
 using namespace shapes;
     
 std::ostream& operator << (std::ostream &os, const StrokeLineCap &cap) {
-    switch(cap) {
-        case StrokeLineCap::BUTT : return os << "butt"; 
-        case StrokeLineCap::ROUND : return os << "round";  
-        case StrokeLineCap::SQUARE : return os << "square";
-        default: return os;
-    }
-    return os;
+    return os << ToString(cap);
 }
     
 std::ostream& operator << (std::ostream &os, const StrokeLineJoin &join)
 {
-    switch(join) {
-        case StrokeLineJoin::ARCS : return os << "arcs"; 
-        case StrokeLineJoin::BEVEL : return os << "bevel";  
-        case StrokeLineJoin::MITER : return os << "miter";
-        case StrokeLineJoin::MITER_CLIP : return os << "miter-clip";  
-        case StrokeLineJoin::ROUND : return os << "round";
-            
-        default: return os;
-    }
-    return os;
+    return os << ToString(join);
 }
 
     
@@ -61,7 +121,7 @@ void Object::Render(const RenderContext& context) const {
     // Делегируем вывод тега своим подклассам
     RenderObject(context);
 
-    context.out << std::endl;
+    context.out += '\n';
 }
 
 // ---------- Circle ------------------
@@ -78,26 +138,122 @@ Circle& Circle::SetRadius(double radius)  {
 
 void Circle::RenderObject(const RenderContext& context) const {
     auto& out = context.out;
-    out << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\" "sv;
-    out << "r=\""sv << radius_ << "\""sv;
+    out += "<circle cx=\""sv;
+    WriteNumber(out, center_.x);
+    out += "\" cy=\""sv;
+    WriteNumber(out, center_.y);
+    out += "\" r=\""sv;
+    WriteNumber(out, radius_);
+    out += '"';
     PathProps::WriteProps(out);
-    out << "/>"sv;
+    out += "/>"sv;
 }
     
 // ----------Document-----------------
+Document::Document()
+    : arena_(std::make_unique<std::pmr::monotonic_buffer_resource>())
+    , objects_(arena_.get()) {
+}
+
+Document& Document::operator=(Document&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    // Распределитель pmr::vector не передаётся ни при присваивании, ни при обмене,
+    // поэтому массивы пересоздаются перемещением: каждый остаётся со своей ареной
+    std::pmr::vector<Element> objects(std::move(other.objects_));
+    std::destroy_at(&other.objects_);
+    std::construct_at(&other.objects_, std::move(objects_));
+    std::destroy_at(&objects_);
+    std::construct_at(&objects_, std::move(objects));
+    arena_.swap(other.arena_);
+    styles_.swap(other.styles_);
+    return *this;
+}
+
 void Document::AddPtr(std::unique_ptr<Object>&& obj) {
-    objects_.push_back(std::move(obj));
+    objects_.emplace_back(std::move(obj));
+}
+
+void Document::Reserve(size_t count) {
+    objects_.reserve(count);
+}
+
+void Document::Add(Circle circle) {
+    objects_.emplace_back(std::move(circle));
+}
+
+void Document::Add(Polyline polyline) {
+    objects_.emplace_back(std::move(polyline));
+}
+
+void Document::Add(Text text) {
+    objects_.emplace_back(std::move(text));
 }
     
 void Document::Render(std::ostream& out) const {
+    std::string text;
+    Render(text);
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+void Document::Render(std::string& out) const {
+    RenderHeader(out);
+    RenderObjects(out);
+    RenderFooter(out);
+}
+
+void Document::RenderObjects(std::string& out) const {
+    // с запасом: тег со свойствами - до 256 символов, вершина ломаной - до 20
+    size_t estimate = 128 + 256 * objects_.size();
+    for (const auto& obj : objects_) {
+        if (const auto* polyline = std::get_if<Polyline>(&obj)) {
+            estimate += 20 * polyline->GetPoints().size();
+        }
+    }
+    out.reserve(out.size() + estimate);
+
     RenderContext context(out);
-    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << std::endl;
-    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << std::endl;
     for (const auto& obj : objects_) {
-        out << "  "sv;
-        obj->Render(context);
+        out += "  "sv;
+        std::visit([&context](const auto& object) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(object)>, std::unique_ptr<Object>>) {
+                object->Render(context);
+            } else {
+                // тип известен и final: вызов без обращения к таблице виртуальных функций
+                context.RenderIndent();
+                object.RenderObject(context);
+                context.out += '\n';
+            }
+        }, obj);
     }
-    out << "</svg>"sv << std::endl;
+}
+
+void Document::RenderHeader(std::string& out) const {
+    out += "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"sv;
+    out += "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n"sv;
+    bool has_classes = false;
+    for (const auto& style : styles_) {
+        if (style->class_name.empty()) {
+            continue;
+        }
+        if (!has_classes) {
+            out += "  <style>\n"sv;
+            has_classes = true;
+        }
+        WriteStyleClass(out, *style);
+    }
+    if (has_classes) {
+        out += "  </style>\n"sv;
+    }
+}
+
+void Document::AddStyle(StylePtr style) {
+    styles_.push_back(std::move(style));
+}
+
+void Document::RenderFooter(std::string& out) {
+    out += "</svg>\n"sv;
 }
     
 // ----------Text---------------------
@@ -118,50 +274,65 @@ Text& Text::SetFontSize(uint32_t size) {
 }
     
 Text& Text::SetFontFamily(std::string font_family) {
-    font_family_ = font_family;
+    font_family_ = std::move(font_family);
     return *this;
 }
 
 Text& Text::SetFontWeight(std::string font_weight) {
-    font_weight_ = font_weight;
+    font_weight_ = std::move(font_weight);
     return *this;
 }
     
 Text& Text::SetData(std::string data) {
-    data_ = data;
+    data_ = std::move(data);
     return *this;
 }
     
 void Text::RenderObject(const RenderContext& context) const {
     auto& out = context.out;
-    out << "<text";    
+    out += "<text"sv;
     PathProps::WriteProps(out);
-    out << " x=\""sv << anchor_point_.x << "\" y=\""sv << anchor_point_.y << "\" "sv;
-    out << "dx=\""sv << offset_.x << "\" dy=\""sv << offset_.y << "\" "sv;
-    out << "font-size=\""sv << font_size_ << "\""sv;
-    if (!font_family_.empty()) {
-        out << " font-family=\""sv << font_family_ << "\""sv;
+    out += " x=\""sv;
+    WriteNumber(out, anchor_point_.x);
+    out += "\" y=\""sv;
+    WriteNumber(out, anchor_point_.y);
+    out += "\" dx=\""sv;
+    WriteNumber(out, offset_.x);
+    out += "\" dy=\""sv;
+    WriteNumber(out, offset_.y);
+    out += "\" font-size=\""sv;
+    WriteNumber(out, font_size_);
+    out += '"';
+    const Style* style = GetInlineStyle();
+    const std::string& font_family = font_family_.empty() && style ? style->font_family : font_family_;
+    const std::string& font_weight = font_weight_.empty() && style ? style->font_weight : font_weight_;
+    if (!font_family.empty()) {
+        out += " font-family=\""sv;
+        out += font_family;
+        out += '"';
     }
-    if (!font_weight_.empty()) {
-        out << " font-weight=\""sv << font_weight_ << "\""sv;
+    if (!font_weight.empty()) {
+        out += " font-weight=\""sv;
+        out += font_weight;
+        out += '"';
     }
-    out << ">";
+    out += '>';
     for (const auto& ch : data_) {
         if (ch == '\"') {
-            out << "&quot;";
+            out += "&quot;"sv;
         } else if (ch == '\'') {
-            out << "&apos;";
+            out += "&apos;"sv;
         } else if (ch == '<') {
-            out << "&lt;";
+            out += "&lt;"sv;
         } else if (ch == '>') {
-            out << "&gt;";
+            out += "&gt;"sv;
         } else if (ch == '&') {
-            out << "&amp;";
+            out += "&amp;"sv;
         } else {
-            out << ch;
+            out += ch;
         }
     }
-    out << "</text>"sv;
+    out += "</text>"sv;
 }
     
 // ----------Polyline------------------
@@ -170,40 +341,71 @@ Polyline& Polyline::AddPoint(Point point) {
     points_.push_back(point);
     return *this;
 }
+
+const std::vector<Point>& Polyline::GetPoints() const {
+    return points_;
+}
     
 void Polyline::RenderObject(const RenderContext& context) const {
     auto& out = context.out;
-    out << "<polyline points=\""sv;
+    out += "<polyline points=\""sv;
     bool need_space = false;
     for (const auto& p : points_) {
         if (need_space) {
-            out << ' ';
+            out += ' ';
         } else {
             need_space = true;
         }
-        out << p.x << ',' << p.y;
+        WriteNumber(out, p.x);
+        out += ',';
+        WriteNumber(out, p.y);
     }
-    out << "\"";
+    out += '"';
     PathProps::WriteProps(out);
-    out << "/>"sv;
+    out += "/>"sv;
 }
 
 template<class T>
-void PathProps<T>::WriteProps(std::ostream& out) const {
-            if (fill_) {
-                out << " fill=\""sv << *fill_ << "\""sv;
+const Style* PathProps<T>::GetInlineStyle() const {
+    return style_ && style_->class_name.empty() ? style_.get() : nullptr;
+}
+
+template<class T>
+void PathProps<T>::WriteProps(std::string& out) const {
+            if (style_ && !style_->class_name.empty()) {
+                out += " class=\""sv;
+                out += style_->class_name;
+                out += '"';
+            }
+            // собственное свойство, иначе свойство оформления, выводимого атрибутами
+            const Style* style = GetInlineStyle();
+            const auto pick = [style](const auto& own, const auto Style::* shared) {
+                return own ? &*own : style && style->*shared ? &*(style->*shared) : nullptr;
+            };
+            if (const auto* fill = pick(fill_, &Style::fill)) {
+                out += " fill=\""sv;
+                out += *fill;
+                out += '"';
             }
-            if (stroke_) {
-                out << " stroke=\""sv << *stroke_ << "\""sv;
+            if (const auto* stroke = pick(stroke_, &Style::stroke)) {
+                out += " stroke=\""sv;
+                out += *stroke;
+                out += '"';
             }
-            if (stroke_width_) {
-                out << " stroke-width=\""sv << *stroke_width_ << "\""sv;
+            if (const auto* stroke_width = pick(stroke_width_, &Style::stroke_width)) {
+                out += " stroke-width=\""sv;
+                WriteNumber(out, *stroke_width);
+                out += '"';
             }
-            if (stroke_linecap_) {
-                out << " stroke-linecap=\""sv << *stroke_linecap_ << "\""sv;
+            if (const auto* stroke_linecap = pick(stroke_linecap_, &Style::stroke_linecap)) {
+                out += " stroke-linecap=\""sv;
+                out += ToString(*stroke_linecap);
+                out += '"';
             }
-            if (stroke_linejoin_) {
-                out << " stroke-linejoin=\""sv << *stroke_linejoin_ << "\""sv;
+            if (const auto* stroke_linejoin = pick(stroke_linejoin_, &Style::stroke_linejoin)) {
+                out += " stroke-linejoin=\""sv;
+                out += ToString(*stroke_linejoin);
+                out += '"';
             }
         }
     
@@ -6,6 +6,9 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <string_view>
+#include <memory_resource>
+#include <variant>
 
 namespace svg {
     
@@ -66,17 +69,19 @@ struct Point {
         : x(x)
         , y(y) {
     }
+    bool operator==(const Point& other) const = default;
     double x = 0;
     double y = 0;
 };
 
 
+// Текст SVG дописывается в конец строки out
 struct RenderContext {
-    RenderContext(std::ostream& out)
+    RenderContext(std::string& out)
         : out(out) {
     }
 
-    RenderContext(std::ostream& out, int indent_step, int indent = 0)
+    RenderContext(std::string& out, int indent_step, int indent = 0)
         : out(out)
         , indent_step(indent_step)
         , indent(indent) {
@@ -87,12 +92,10 @@ struct RenderContext {
     }
 
     void RenderIndent() const {
-        for (int i = 0; i < indent; ++i) {
-            out.put(' ');
-        }
+        out.append(indent, ' ');
     }
 
-    std::ostream& out;
+    std::string& out;
     int indent_step = 0;
     int indent = 0;
 };
@@ -108,15 +111,35 @@ private:
 };
 
 
+// Оформление, общее для многих объектов: объекты ссылаются на один экземпляр
+// вместо собственных копий свойств. Собственное свойство объекта выводится вместо
+// одноимённого свойства оформления.
+// Оформление с непустым class_name выводится один раз в блоке <style> документа,
+// объект получает атрибут class; иначе его свойства выводятся атрибутами каждого объекта.
+// Правило класса сильнее атрибута, поэтому свойства, которые объекты задают сами, в класс не входят
+struct Style {
+    std::string class_name;
+    std::optional<Color> fill;
+    std::optional<Color> stroke;
+    std::optional<double> stroke_width;
+    std::optional<StrokeLineCap> stroke_linecap;
+    std::optional<StrokeLineJoin> stroke_linejoin;
+    // только для Text
+    std::string font_family;
+    std::string font_weight;
+};
+
+using StylePtr = std::shared_ptr<const Style>;
+
 template<class T>
 class PathProps {
     public:
         T& SetFillColor(Color color){
-            fill_ = color;
+            fill_ = std::move(color);
             return *static_cast<T*>(this);
         }
         T& SetStrokeColor(Color color){
-            stroke_ = color;
+            stroke_ = std::move(color);
             return *static_cast<T*>(this);
         }
         T& SetStrokeWidth(double width){
@@ -131,9 +154,17 @@ class PathProps {
             stroke_linejoin_ = line_join;
             return *static_cast<T*>(this);
         }
-        void WriteProps(std::ostream& context) const;
+        T& SetStyle(StylePtr style) {
+            style_ = std::move(style);
+            return *static_cast<T*>(this);
+        }
+        void WriteProps(std::string& out) const;
 protected:
-    
+    // оформление, свойства которого выводятся атрибутами объекта
+    const Style* GetInlineStyle() const;
+
+    StylePtr style_;
+
     std::optional<Color> fill_;
     std::optional<Color> stroke_;
     std::optional<double> stroke_width_;
@@ -146,9 +177,8 @@ public:
     Circle& SetCenter(Point center);
     Circle& SetRadius(double radius);
 
-private:
     void RenderObject(const RenderContext& context) const override;
-
+private:
     Point center_;
     double radius_ = 1.0;
 };
@@ -158,6 +188,7 @@ class Polyline final : public Object, public PathProps<Polyline> {
 public:
     // Добавляет очередную вершину к ломаной линии
     Polyline& AddPoint(Point point);
+    const std::vector<Point>& GetPoints() const;
 
     void RenderObject(const RenderContext& context) const override;
 private:
@@ -190,15 +221,44 @@ private:
 };
 
        
+// Круги, ломаные и тексты хранятся по значению в одном массиве из арены документа
+// и выводятся без виртуальных вызовов; прочие объекты - через указатель на Object.
+// Объекты выводятся в порядке добавления, поток при выводе не сбрасывается
 class Document : public ObjectContainer {
 public:
+    Document();
+    // Массив объектов переходит вместе со своей ареной
+    Document(Document&& other) noexcept = default;
+    // Обменивает арены и массивы объектов: старые объекты освобождаются вместе с other
+    Document& operator=(Document&& other) noexcept;
 
     void AddPtr(std::unique_ptr<Object>&& obj) override;
+    void Add(Circle circle);
+    void Add(Polyline polyline);
+    void Add(Text text);
+    using ObjectContainer::Add;
+    // Заранее выделяет место под count объектов, чтобы массив не перестраивался
+    void Reserve(size_t count);
 
     void Render(std::ostream& out) const;
+    // Дописывает документ в out, заранее выделив память по числу объектов и вершин
+    void Render(std::string& out) const;
+    // Только объекты, без заголовка и закрывающего тега: документ можно собрать
+    // из частей, выведенных отдельно
+    void RenderObjects(std::string& out) const;
+    // Заголовок с блоком <style> для добавленных оформлений с именем класса
+    void RenderHeader(std::string& out) const;
+    static void RenderFooter(std::string& out);
+
+    // Оформление попадает в блок <style>, если у него есть имя класса
+    void AddStyle(StylePtr style);
 
 private:
-    std::vector<std::unique_ptr<Object>> objects_;
+    using Element = std::variant<Circle, Polyline, Text, std::unique_ptr<Object>>;
+
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
+    std::pmr::vector<Element> objects_;
+    std::vector<StylePtr> styles_;
 };
     
 namespace shapes {
@@ -0,0 +1,92 @@
+// Сверка пакетного расчёта CoordinatesTable::ComputeDistances с geo::ComputeDistance.
+// Сборка из каталога transport-catalogue:
+//   g++ -std=c++20 -O2 tests/geo_test.cpp geo.cpp -I. -o geo_test && ./geo_test
+// (с -mavx2 проверяется и векторная ветка)
+
+#include "geo.h"
+
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Допуск в метрах: ComputeDistances использует другую, но равносильную формулу
+// косинуса центрального угла, поэтому ошибки округления у них разные
+constexpr double TOLERANCE = 0.01;
+
+void TestMatchesComputeDistance() {
+    mt19937 generator(42);
+    // остановки города - от соседних до удалённых на десятки километров
+    uniform_real_distribution<double> lat(55.5, 56.);
+    uniform_real_distribution<double> lng(37.3, 37.9);
+    uniform_real_distribution<double> near(-1e-4, 1e-4);
+
+    geo::CoordinatesTable table;
+    vector<geo::Coordinates> places;
+    for (int i = 0; i < 2000; ++i) {
+        places.push_back({lat(generator), lng(generator)});
+        if (i % 2 == 1) {
+            places.back() = {places[i - 1].lat + near(generator), places[i - 1].lng + near(generator)};
+        }
+        table.Add(places.back());
+    }
+
+    vector<size_t> from;
+    vector<size_t> to;
+    uniform_int_distribution<size_t> index(0, places.size() - 1);
+    for (size_t i = 0; i + 1 < places.size(); ++i) {
+        from.push_back(i);
+        to.push_back(i + 1);
+        from.push_back(index(generator));
+        to.push_back(index(generator));
+    }
+    vector<double> distances(from.size());
+    table.ComputeDistances(from.data(), to.data(), from.size(), distances.data());
+
+    double max_error = 0.;
+    for (size_t i = 0; i < from.size(); ++i) {
+        if (places[from[i]] == places[to[i]]) {
+            continue;
+        }
+        max_error = max(max_error, abs(distances[i] - geo::ComputeDistance(places[from[i]], places[to[i]])));
+    }
+    cerr << "max error: "s << max_error << " m\n"s;
+    assert(max_error < TOLERANCE);
+}
+
+// Аргумент acos для совпадающих точек может выйти за единицу: расстояние должно
+// остаться числом. Точнее sqrt(2 * DBL_EPSILON) * EarthRadius (около 0.13 м)
+// формула через acos не различает, поэтому ноль не требуется
+void TestSamePlace() {
+    geo::CoordinatesTable table;
+    const size_t a = table.Add({55.611087, 37.20829});
+    const size_t b = table.Add({55.611087, 37.20829});
+    double distance = -1.;
+    table.ComputeDistances(&a, &b, 1, &distance);
+    assert(distance >= 0. && distance < 0.2);
+    assert(table.ComputePathLength({a, b, a}) < 0.4);
+}
+
+void TestPathLength() {
+    geo::CoordinatesTable table;
+    const vector<geo::Coordinates> places{{55.611087, 37.20829}, {55.595884, 37.209755}, {55.632761, 37.333324}};
+    for (const auto& place : places) {
+        table.Add(place);
+    }
+    const double expected = geo::ComputeDistance(places[0], places[1]) + geo::ComputeDistance(places[1], places[2]);
+    assert(abs(table.ComputePathLength({0, 1, 2}) - expected) < TOLERANCE);
+}
+
+}  // namespace
+
+int main() {
+    TestMatchesComputeDistance();
+    TestSamePlace();
+    TestPathLength();
+    cerr << "geo tests passed\n"s;
+}
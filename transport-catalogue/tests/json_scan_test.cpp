@@ -0,0 +1,97 @@
+// Сверка векторных веток json::FindAnyOf (AVX2, SSE2) с посимвольной.
+// Сборка из каталога transport-catalogue:
+//   g++ -std=c++20 -O2 -mavx2 tests/json_scan_test.cpp -I. -o json_scan_test && ./json_scan_test
+// (без -mavx2 проверяется только ветка SSE2, без SSE2 - только посимвольная)
+
+#include "json_scan.h"
+
+#include <cassert>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// Все доступные в сборке ветки находят в text тот же символ, что и посимвольная.
+// Поиск идёт с каждого смещения first, чтобы блоки ложились на текст по-разному
+template <char... Chars>
+void AssertPathsAgree(const string& text) {
+    const char* end = text.data() + text.size();
+    for (size_t first = 0; first <= text.size(); ++first) {
+        const char* begin = text.data() + first;
+        const char* expected = json::FindAnyOfScalar<Chars...>(begin, end);
+#if defined(__SSE2__)
+        assert(json::FindAnyOfSse2<Chars...>(begin, end) == expected);
+#endif
+#if defined(__AVX2__)
+        assert(json::FindAnyOfAvx2<Chars...>(begin, end) == expected);
+#endif
+        assert(json::FindAnyOf<Chars...>(begin, end) == expected);
+    }
+}
+
+// Искомый символ на каждой позиции строк длиной от пустой до трёх блоков AVX2,
+// то есть у каждой границы блоков по 16 и 32 байта
+void TestSingleMatch() {
+    for (size_t size = 0; size <= 100; ++size) {
+        AssertPathsAgree<'"', '\\'>(string(size, 'a'));
+        for (size_t pos = 0; pos < size; ++pos) {
+            string text(size, 'a');
+            text[pos] = '"';
+            AssertPathsAgree<'"', '\\'>(text);
+            text[pos] = '\\';
+            AssertPathsAgree<'"', '\\'>(text);
+        }
+    }
+}
+
+// Несколько совпадений: найтись должно первое, в том числе когда следующее
+// лежит в том же блоке или в соседнем
+void TestFirstOfSeveral() {
+    for (size_t size = 1; size <= 80; ++size) {
+        for (size_t pos = 0; pos < size; ++pos) {
+            for (size_t gap : {1u, 15u, 16u, 17u, 31u, 32u, 33u}) {
+                string text(size, 'x');
+                text[pos] = '{';
+                if (pos + gap < size) {
+                    text[pos + gap] = ']';
+                }
+                AssertPathsAgree<'"', '[', ']', '{', '}'>(text);
+            }
+        }
+    }
+}
+
+// Длинные строки: совпадение после многих пустых блоков и у конца строки
+void TestLongStrings() {
+    for (size_t size : {1000u, 1023u, 1024u, 1025u, 4096u + 7u}) {
+        AssertPathsAgree<'\r', '\n', '\t', '"', '\\'>(string(size, 'z'));
+        for (size_t pos : {size / 2 - 1, size / 2, size - 33, size - 32, size - 17, size - 16, size - 1}) {
+            string text(size, 'z');
+            text[pos] = '\t';
+            AssertPathsAgree<'\r', '\n', '\t', '"', '\\'>(text);
+        }
+    }
+}
+
+// Байты со старшим битом (UTF-8) не совпадают с искомыми символами
+void TestHighBytes() {
+    string text;
+    for (int i = 0; i < 64; ++i) {
+        text += "Ст"s;
+    }
+    AssertPathsAgree<'"', '\\', '\n', '\r'>(text);
+    text[70] = '\n';
+    AssertPathsAgree<'"', '\\', '\n', '\r'>(text);
+}
+
+}  // namespace
+
+int main() {
+    TestSingleMatch();
+    TestFirstOfSeveral();
+    TestLongStrings();
+    TestHighBytes();
+    cerr << "json_scan tests passed\n"s;
+}
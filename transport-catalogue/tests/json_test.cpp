@@ -0,0 +1,254 @@
+// Разбор JSON из буфера (json::Load(std::string_view), LoadBuffer, LoadFile, Parse)
+// в сравнении с разбором из потока.
+// Сборка из каталога transport-catalogue:
+//   g++ -std=c++20 -O2 tests/json_test.cpp json.cpp json_writer.cpp -I. -o json_test && ./json_test
+// С путём к файлу JSON в аргументе после проверок выводит время его разбора
+// потоком, из буфера и через LoadFile (замерять лучше в сборке с -DNDEBUG)
+
+#include "json.h"
+#include "log_duration.h"
+
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <variant>
+
+using namespace std;
+
+namespace {
+
+// Обработчик событий, который только проверяет, что разбор проходит
+class IgnoreEvents : public json::EventHandler {
+public:
+    void StartDict() override {}
+    void Key(string_view) override {}
+    void EndDict() override {}
+    void StartArray() override {}
+    void EndArray() override {}
+    void Null() override {}
+    void Bool(bool) override {}
+    void Int(int) override {}
+    void Double(double) override {}
+    void String(string_view) override {}
+};
+
+// Разбирает text всеми способами, проверяет, что результаты совпадают,
+// и возвращает результат LoadBuffer
+json::Document LoadEverywhere(const string& text) {
+    istringstream input(text);
+    const json::Document from_stream = json::Load(input);
+    const json::Document from_view = json::Load(string_view(text));
+    json::Document from_buffer = json::LoadBuffer(text);
+    assert(from_view == from_stream);
+    assert(from_buffer == from_stream);
+    IgnoreEvents events;
+    json::Parse(text, events);
+    return from_buffer;
+}
+
+template <typename Function>
+bool ThrowsParsingError(Function function) {
+    try {
+        function();
+    } catch (const json::ParsingError&) {
+        return true;
+    }
+    return false;
+}
+
+// Ни один из способов разбора не принимает text
+void AssertRejected(const string& text) {
+    assert(ThrowsParsingError([&] {
+        istringstream input(text);
+        json::Load(input);
+    }));
+    assert(ThrowsParsingError([&] { json::Load(string_view(text)); }));
+    assert(ThrowsParsingError([&] { json::LoadBuffer(text); }));
+    assert(ThrowsParsingError([&] {
+        IgnoreEvents events;
+        json::Parse(text, events);
+    }));
+}
+
+void TestNumbers() {
+    auto root = [](const string& text) {
+        return LoadEverywhere(text).GetRoot();
+    };
+    assert(root("0"s).AsInt() == 0);
+    assert(root("-0"s).AsInt() == 0);
+    assert(root("42"s).AsInt() == 42);
+    assert(root("-17"s).AsInt() == -17);
+    assert(root("2147483647"s).AsInt() == 2147483647);
+    assert(root("-2147483648"s).AsInt() == -2147483647 - 1);
+    // Не помещающееся в int целое читается как double
+    assert(root("2147483648"s).IsPureDouble());
+    assert(root("2147483648"s).AsDouble() == 2147483648.);
+    assert(root("1.5"s).AsDouble() == 1.5);
+    assert(root("-0.25"s).AsDouble() == -0.25);
+    assert(root("0.1"s).AsDouble() == 0.1);
+    assert(root("1E2"s).IsPureDouble());
+    assert(root("1E2"s).AsDouble() == 100.);
+    assert(root("-2.5e3"s).AsDouble() == -2500.);
+    assert(root("1e-2"s).AsDouble() == 0.01);
+    assert(root("5e+1"s).AsDouble() == 50.);
+    assert(root("3.141592653589793238462643383279"s).AsDouble() == 3.141592653589793);
+    assert(root("55.611087"s).AsDouble() == 55.611087);
+
+    const json::Document doc = LoadEverywhere("[1, -2.5, 3e0, 4]"s);
+    const auto& items = doc.GetRoot().AsArray();
+    assert(items.size() == 4u);
+    assert(items[0].IsInt() && items[1].IsPureDouble() && items[2].IsPureDouble() && items[3].IsInt());
+
+    AssertRejected("-"s);
+    AssertRejected("--1"s);
+    AssertRejected("1."s);
+    AssertRejected("1.e5"s);
+    AssertRejected("1e"s);
+    AssertRejected("1e+"s);
+    AssertRejected("[1, -]"s);
+}
+
+void TestEscapes() {
+    const json::Document doc = LoadEverywhere(R"(["a\nb", "\t\r", "q\"q", "back\\slash", "\\n", ""])"s);
+    const auto& items = doc.GetRoot().AsArray();
+    assert(items.size() == 6u);
+    assert(items[0].AsString() == "a\nb"s);
+    assert(items[1].AsString() == "\t\r"s);
+    assert(items[2].AsString() == "q\"q"s);
+    assert(items[3].AsString() == "back\\slash"s);
+    assert(items[4].AsString() == "\\n"s);
+    assert(items[5].AsString().empty());
+
+    // Длинная строка, escape-последовательность сразу за границей блоков поиска
+    const string head(33, 'x');
+    const json::Document long_doc = LoadEverywhere("\""s + head + "\\\"" + head + "\""s);
+    assert(long_doc.GetRoot().AsString() == head + "\""s + head);
+
+    AssertRejected(R"("\x")"s);
+    AssertRejected(R"("\u0041")"s);
+    AssertRejected("\"unterminated"s);
+    AssertRejected("\"line\nbreak\""s);
+    AssertRejected("\"ends with backslash\\"s);
+}
+
+void TestBufferStrings() {
+    const json::Document doc = json::LoadBuffer(R"({"plain": "text", "escaped": "a\nb"})"s);
+    const auto& dict = doc.GetRoot().AsDict();
+    const auto& plain = dict.at("plain"sv);
+    assert(holds_alternative<json::BufferString>(plain.GetValue()));
+    const string_view text = *doc.GetText();
+    assert(plain.AsStringView().data() >= text.data());
+    assert(plain.AsStringView().data() + plain.AsStringView().size() <= text.data() + text.size());
+    // Строку с escape-последовательностью пришлось раскодировать
+    assert(holds_alternative<string>(dict.at("escaped"sv).GetValue()));
+    assert(dict.at("escaped"sv).AsString() == "a\nb"s);
+
+    // Копия узла остаётся действительной, пока жив документ
+    const json::Node copy = plain;
+    assert(copy.AsString() == "text"s);
+}
+
+void TestNesting() {
+    const json::Document doc = LoadEverywhere(R"(
+        {"z": [1, {"a": [], "b": {}}, [null, true, false]],
+         "a": {"x": {"y": ["deep"]}},
+         "m": ""}
+    )"s);
+    const auto& root = doc.GetRoot().AsDict();
+    assert(root.size() == 3u);
+    // Ключи словаря идут по порядку
+    assert(root.begin()->first == "a"s);
+    assert(root.at("a"sv).AsDict().at("x"sv).AsDict().at("y"sv).AsArray()[0].AsString() == "deep"s);
+    const auto& z = root.at("z"sv).AsArray();
+    assert(z.size() == 3u);
+    assert(z[1].AsDict().at("a"sv).AsArray().empty());
+    assert(z[1].AsDict().at("b"sv).AsDict().empty());
+    assert(z[2].AsArray()[0].IsNull());
+    assert(z[2].AsArray()[1].AsBool());
+    assert(!z[2].AsArray()[2].AsBool());
+
+    const int depth = 1000;
+    const json::Document deep = LoadEverywhere(string(depth, '[') + string(depth, ']'));
+    const json::Node* node = &deep.GetRoot();
+    for (int i = 1; i < depth; ++i) {
+        assert(node->AsArray().size() == 1u);
+        node = &node->AsArray()[0];
+    }
+    assert(node->AsArray().empty());
+}
+
+void TestErrors() {
+    AssertRejected(""s);
+    AssertRejected("   "s);
+    AssertRejected("[1, 2"s);
+    AssertRejected("[[]"s);
+    AssertRejected(R"({"a" 1})"s);
+    AssertRejected(R"({"a": 1)"s);
+    AssertRejected(R"({"a": 1; "b": 2})"s);
+    AssertRejected(R"({a: 1})"s);
+    AssertRejected(R"({"a": 1, "a": 2})"s);
+    AssertRejected(R"([{"k": 1, "j": {}, "k": []}])"s);
+    AssertRejected("tru"s);
+    AssertRejected("nul"s);
+    AssertRejected("nil"s);
+}
+
+void TestLoadFile() {
+    const string path = "json_test_input.json"s;
+    const string text = R"({"base_requests": [{"name": "A\tB", "latitude": 55.5}], "n": 7})"s;
+    {
+        ofstream out(path, ios::binary);
+        out << text;
+    }
+    const json::Document from_file = json::LoadFile(path);
+    assert(from_file == LoadEverywhere(text));
+    remove(path.c_str());
+
+    bool failed = false;
+    try {
+        json::LoadFile(path);
+    } catch (const runtime_error&) {
+        failed = true;
+    }
+    assert(failed);
+}
+
+void TimeLoaders(const string& path) {
+    ifstream file(path, ios::binary);
+    const string text{istreambuf_iterator<char>(file), istreambuf_iterator<char>()};
+    istringstream input(text);
+    // Документ разрушается вне замера
+    const json::Document from_stream = [&] {
+        LogDuration guard("Load(istream)"s);
+        return json::Load(input);
+    }();
+    const json::Document from_view = [&] {
+        LogDuration guard("Load(string_view)"s);
+        return json::Load(string_view(text));
+    }();
+    const json::Document from_file = [&] {
+        LogDuration guard("LoadFile"s);
+        return json::LoadFile(path);
+    }();
+    assert(from_view == from_stream);
+    assert(from_file == from_stream);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    TestNumbers();
+    TestEscapes();
+    TestBufferStrings();
+    TestNesting();
+    TestErrors();
+    TestLoadFile();
+    cerr << "json tests passed\n"s;
+    if (argc > 1) {
+        TimeLoaders(argv[1]);
+    }
+}
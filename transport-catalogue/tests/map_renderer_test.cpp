@@ -0,0 +1,193 @@
+// Плитки карты MapRenderer::RenderTile в сравнении с картой целиком.
+// Сборка из каталога transport-catalogue:
+//   g++ -std=c++20 -O2 -pthread tests/map_renderer_test.cpp $(ls *.cpp | grep -vx main.cpp) -I. -o map_renderer_test && ./map_renderer_test
+
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "request_handler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Случайная сеть: остановки в пределах города, линейные и кольцевые маршруты
+string MakeInput(unsigned seed, int stop_count, int bus_count) {
+    mt19937 generator(seed);
+    uniform_real_distribution<double> lat(55.5, 56.);
+    uniform_real_distribution<double> lng(37.3, 37.9);
+    uniform_int_distribution<int> stop(0, stop_count - 1);
+    uniform_int_distribution<int> length(2, 8);
+
+    ostringstream out;
+    out.precision(17);
+    out << R"({"base_requests": [)";
+    for (int i = 0; i < stop_count; ++i) {
+        out << R"({"type": "Stop", "name": "Stop )" << i << R"(", "latitude": )" << lat(generator)
+            << R"(, "longitude": )" << lng(generator) << R"(, "road_distances": {}}, )";
+    }
+    for (int i = 0; i < bus_count; ++i) {
+        const bool roundtrip = i % 2 == 1;
+        const int first = stop(generator);
+        out << R"({"type": "Bus", "name": "Bus )" << i << R"(", "is_roundtrip": )" << (roundtrip ? "true" : "false")
+            << R"(, "stops": ["Stop )" << first << '"';
+        for (int j = length(generator); j > 1; --j) {
+            out << R"(, "Stop )" << stop(generator) << '"';
+        }
+        if (roundtrip) {
+            out << R"(, "Stop )" << first << '"';
+        }
+        out << "]}" << (i + 1 < bus_count ? ", " : "");
+    }
+    out << R"(], "render_settings": {"width": 1200.0, "height": 800.0, "padding": 50.0, "line_width": 14.0,
+        "stop_radius": 5.0, "bus_label_font_size": 20, "bus_label_offset": [7.0, 15.0],
+        "stop_label_font_size": 18, "stop_label_offset": [7.0, -3.0],
+        "underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3.0,
+        "color_palette": ["green", [255, 160, 0], "red"]},
+        "routing_settings": {"bus_wait_time": 6, "bus_velocity": 40}, "stat_requests": []})";
+    return out.str();
+}
+
+// Объект SVG: его точки и всё остальное (тег, оформление, текст) без координат
+struct Shape {
+    string kind;
+    vector<svg::Point> points;
+};
+
+vector<Shape> ParseShapes(const svg::Document& doc) {
+    string text;
+    doc.RenderObjects(text);
+    static const regex position(R"re( (points|cx|cy|x|y)="([^"]*)")re");
+    vector<Shape> shapes;
+    istringstream lines(text);
+    for (string line; getline(lines, line);) {
+        Shape shape;
+        vector<double> values;
+        for (sregex_iterator it(line.begin(), line.end(), position), end; it != end; ++it) {
+            // точки линии - пары "x,y" через пробел
+            string attribute = (*it)[2].str();
+            replace(attribute.begin(), attribute.end(), ',', ' ');
+            istringstream numbers(attribute);
+            for (double value; numbers >> value;) {
+                values.push_back(value);
+            }
+        }
+        assert(values.size() % 2 == 0);
+        for (size_t i = 0; i < values.size(); i += 2) {
+            shape.points.push_back({values[i], values[i + 1]});
+        }
+        shape.kind = regex_replace(line, position, "");
+        shapes.push_back(move(shape));
+    }
+    return shapes;
+}
+
+// Координаты выводятся с 6 значащими цифрами
+bool IsNear(svg::Point lhs, svg::Point rhs) {
+    return abs(lhs.x - rhs.x) < 0.05 && abs(lhs.y - rhs.y) < 0.05;
+}
+
+class TileTest {
+public:
+    explicit TileTest(const string& input) {
+        istringstream in(input);
+        reader_.ParseCommands(in);
+        handler::CatalogueConstructor(db_, reader_.GetBaseSettings()).FillFromCommands(reader_.GetCommands());
+        // Визуализатор читает настройки уже при создании
+        renderer_.emplace(reader_.GetSettings(), db_);
+    }
+
+    const renderer::MapRenderer& GetRenderer() const {
+        return *renderer_;
+    }
+
+private:
+    JsonReader reader_;
+    transport::TransportCatalogue db_;
+    optional<renderer::MapRenderer> renderer_;
+};
+
+// Единственная плитка масштаба 0 - это вся карта
+void TestZeroZoomIsWholeMap(const renderer::MapRenderer& renderer) {
+    string map;
+    renderer.Render().RenderObjects(map);
+    string tile;
+    renderer.RenderTile(0, 0, 0).RenderObjects(tile);
+    assert(!map.empty());
+    assert(tile == map);
+}
+
+// Каждый объект карты есть хотя бы в одной из четырёх плиток масштаба 1,
+// у линий маршрутов - каждый отрезок
+void TestFirstZoomCoversMap(const renderer::MapRenderer& renderer) {
+    const auto& settings = renderer.GetSettings();
+    struct Tile {
+        svg::Point origin;
+        vector<Shape> shapes;
+    };
+    vector<Tile> tiles;
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 2; ++x) {
+            tiles.push_back({{x * settings.width / 2, y * settings.height / 2}, ParseShapes(renderer.RenderTile(1, x, y))});
+        }
+    }
+    // Есть ли в какой-нибудь плитке объект того же вида с точками points карты подряд
+    auto covered = [&tiles](const string& kind, const vector<svg::Point>& points) {
+        for (const auto& tile : tiles) {
+            vector<svg::Point> expected;
+            for (const auto& point : points) {
+                expected.push_back({(point.x - tile.origin.x) * 2, (point.y - tile.origin.y) * 2});
+            }
+            for (const auto& shape : tile.shapes) {
+                if (shape.kind != kind || shape.points.size() < expected.size()) {
+                    continue;
+                }
+                for (size_t first = 0; first + expected.size() <= shape.points.size(); ++first) {
+                    size_t i = 0;
+                    while (i < expected.size() && IsNear(shape.points[first + i], expected[i])) {
+                        ++i;
+                    }
+                    if (i == expected.size()) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    };
+
+    size_t checked = 0;
+    for (const auto& shape : ParseShapes(renderer.Render())) {
+        if (shape.points.size() == 1) {
+            assert(covered(shape.kind, shape.points));
+            ++checked;
+            continue;
+        }
+        for (size_t i = 0; i + 1 < shape.points.size(); ++i) {
+            assert(covered(shape.kind, {shape.points[i], shape.points[i + 1]}));
+            ++checked;
+        }
+    }
+    assert(checked > 0);
+}
+
+}  // namespace
+
+int main() {
+    for (unsigned seed : {1u, 2u, 3u}) {
+        const TileTest test(MakeInput(seed, 40, 8));
+        TestZeroZoomIsWholeMap(test.GetRenderer());
+        TestFirstZoomCoversMap(test.GetRenderer());
+    }
+    cerr << "map_renderer tests passed\n"s;
+}
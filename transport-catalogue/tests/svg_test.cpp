@@ -0,0 +1,75 @@
+// Перемещение svg::Document вместе с ареной объектов.
+// Сборка из каталога transport-catalogue:
+//   g++ -std=c++20 -O2 tests/svg_test.cpp svg.cpp -I. -o svg_test && ./svg_test
+// (с -fsanitize=address проверяется и освобождение арен)
+
+#include "svg.h"
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+string RenderToString(const svg::Document& doc) {
+    string out;
+    doc.Render(out);
+    return out;
+}
+
+svg::Document MakeDocument(double radius, int count) {
+    svg::Document doc;
+    for (int i = 0; i < count; ++i) {
+        doc.Add(svg::Circle{}.SetCenter({double(i), 0.}).SetRadius(radius));
+    }
+    doc.Add(svg::Text{}.SetPosition({1., 2.}).SetData("label"s));
+    return doc;
+}
+
+void TestMoveAssign() {
+    svg::Document a;
+    a.Add(svg::Circle{});
+    svg::Document b;
+    b.Add(svg::Circle{});
+    b.Add(svg::Circle{}.SetRadius(2.));
+    const string expected_b = RenderToString(b);
+    a = std::move(b);
+    assert(RenderToString(a) == expected_b);
+
+    svg::Document target = MakeDocument(1., 3);
+    const string expected = RenderToString(MakeDocument(5., 100));
+    svg::Document source = MakeDocument(5., 100);
+    target = std::move(source);
+    assert(RenderToString(target) == expected);
+    // после присваивания документ пополняется в своей арене
+    target.Add(svg::Circle{}.SetRadius(7.));
+    assert(RenderToString(target).find("r=\"7\""s) != string::npos);
+}
+
+void TestMoveAssignToSelf() {
+    svg::Document doc = MakeDocument(2., 10);
+    const string expected = RenderToString(doc);
+    svg::Document& same = doc;
+    doc = std::move(same);
+    assert(RenderToString(doc) == expected);
+}
+
+void TestMovedFromIsAssignable() {
+    svg::Document first = MakeDocument(3., 10);
+    svg::Document second(std::move(first));
+    first = MakeDocument(4., 20);
+    assert(RenderToString(first) == RenderToString(MakeDocument(4., 20)));
+    assert(RenderToString(second) == RenderToString(MakeDocument(3., 10)));
+}
+
+}  // namespace
+
+int main() {
+    TestMoveAssign();
+    TestMoveAssignToSelf();
+    TestMovedFromIsAssignable();
+    cerr << "svg tests passed\n"s;
+}
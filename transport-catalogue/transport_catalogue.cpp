@@ -1,69 +1,226 @@
 #include <unordered_set>
+#include <algorithm>
 
 #include "transport_catalogue.h"
 #include "geo.h"
+#include "parallel.h"
 #include <sstream>
 
 using namespace transport;
 using namespace geo;
 
 std::string_view TransportCatalogue::AddId(const std::string_view id) {
-    ids_.push_front(std::string {id});
-    return {ids_.front().begin(), ids_.front().end()};
+    ids_->push_front(std::string {id});
+    return {ids_->front().begin(), ids_->front().end()};
+}
+
+StopDescription& TransportCatalogue::MutableStop(const std::string_view id) {
+    auto& stop = stops_.at(id);
+    if (stop.use_count() > 1) {
+        // описание разделяется с другой версией справочника
+        stop = std::make_shared<StopDescription>(*stop);
+        stops_by_index_[stop->index] = stop.get();
+    }
+    return *stop;
 }
 
 void TransportCatalogue::AddStop(const std::string_view id, const Coordinates place) {
+    if (stops_.count(id) > 0) {
+        auto& stop = MutableStop(id);
+        stop.place = place;
+        places_.Set(stop.index, place);
+        return;
+    }
     std::string_view stop_id = AddId(id);
-    stops_.insert({stop_id, {stop_id, place, {}}});
-    busses4stop_.insert({stop_id, {}});
+    auto stop = std::make_shared<StopDescription>(StopDescription {stop_id, place, {}, stops_.size()});
+    stops_by_index_.push_back(stop.get());
+    places_.Add(place);
+    stops_.insert({stop_id, std::move(stop)});
 }
 
 void TransportCatalogue::AddBus(const std::string_view id, const std::vector<std::string_view>& stops, const std::vector<std::string_view>& final_stops) {
-    std::string_view bus_id = AddId(id);
+    AddBus(MakeBus(id, stops, final_stops));
+}
+
+BusDescription TransportCatalogue::MakeBus(const std::string_view id, const std::vector<std::string_view>& stops, const std::vector<std::string_view>& final_stops) const {
     std::vector<std::string_view> stops_ids;
+    std::vector<size_t> stop_indexes;
     stops_ids.reserve(stops.size());
+    stop_indexes.reserve(stops.size());
     for (const auto& stop : stops) {
-        stops_ids.push_back(stops_.at(stop).id);
-        busses4stop_[stops_ids.back()].insert(bus_id);
+        const auto& descr = *stops_.at(stop);
+        stops_ids.push_back(descr.id);
+        stop_indexes.push_back(descr.index);
     }
     std::vector<std::string_view> final_stops_ids;
+    final_stops_ids.reserve(final_stops.size());
     for (const auto& stop : final_stops) {
-        final_stops_ids.push_back(stops_.at(stop).id);
+        final_stops_ids.push_back(stops_.at(stop)->id);
     }
-    buses_.insert({bus_id, {bus_id, std::move(stops_ids), std::move(final_stops_ids)}});
+    return {id, std::move(stops_ids), std::move(final_stops_ids), std::move(stop_indexes)};
+}
+
+void TransportCatalogue::AddBus(BusDescription bus) {
+    const auto bus_ptr = buses_.find(bus.id);
+    if (bus_ptr != buses_.end()) {
+        bus.id = bus_ptr->first;
+    } else {
+        bus.id = AddId(bus.id);
+        bus_order_.push_back(bus.id);
+    }
+    const std::string_view bus_id = bus.id;
+    buses_[bus_id] = std::make_shared<const BusDescription>(std::move(bus));
 }
 
 void TransportCatalogue::AddDistance(const std::string_view from, const std::string_view to, const int dist) {
-    stops_.at(from).distances[stops_.at(to).id] = dist;
+    const std::string_view to_id = stops_.at(to)->id;
+    MutableStop(from).distances[to_id] = dist;
 }
 
-void TransportCatalogue::BuildMapGraph(const int velocity, const TimeUnit time) {
+void TransportCatalogue::Reserve(const size_t stops_count, const size_t buses_count) {
+    stops_.reserve(stops_count);
+    stops_by_index_.reserve(stops_count);
+    places_.Reserve(stops_count);
+    buses_.reserve(buses_count);
+    bus_order_.reserve(buses_count);
+}
+
+size_t TransportCatalogue::GetStopsCount() const {
+    return stops_.size();
+}
+
+void TransportCatalogue::AddDistances(const std::string_view from, const std::vector<domain::StopDistance>& distances) {
+    auto& stop = MutableStop(from);
+    stop.distances.reserve(stop.distances.size() + distances.size());
+    for (const auto& to : distances) {
+        stop.distances[stops_.at(to.stop)->id] = to.distance;
+    }
+}
+
+TransportCatalogue TransportCatalogue::Fork() const {
+    TransportCatalogue next;
+    next.ids_ = ids_;
+    next.stops_ = stops_;
+    next.stops_by_index_ = stops_by_index_;
+    next.places_ = places_;
+    next.buses_ = buses_;
+    next.bus_order_ = bus_order_;
+    return next;
+}
+
+void TransportCatalogue::BuildMapGraph(const int velocity, const TimeUnit time, const size_t threads) {
+    stop_map_ = {};
+    map2stop_.clear();
+    stop2map_.clear();
+    bus2map_.clear();
+    map2stop_.reserve(stops_.size());
+    stop2map_.reserve(stops_.size());
     std::vector<const StopDescription*> descr;
-    for (const auto& [name, sd] : stops_) {
+    descr.reserve(stops_.size());
+    // Вершины и рёбра нумеруются в порядке добавления остановок и маршрутов, а не в порядке
+    // хеш-таблиц: тот зависит от числа корзин, и при равном времени пути выбирался бы
+    // другой маршрут у справочников с одними данными, загруженных разными способами
+    for (const auto* sd : stops_by_index_) {
         const auto idx = std::pair<graph::VertexId, graph::VertexId> {stop_map_.AddVertex(), stop_map_.AddVertex()} ;
-        map2stop_[name] = idx;
-        stop2map_[idx.first] = name;
-        descr.push_back(&sd);
+        map2stop_[sd->id] = idx;
+        stop2map_[idx.first] = sd->id;
+        descr.push_back(sd);
         stop_map_.AddEdge({idx.first, idx.second, time});
     }
-    for (const auto& [id, bus] : buses_) {
-        if (bus.stops.empty()) {
-            continue;
+
+    std::vector<const BusDescription*> buses;
+    buses.reserve(bus_order_.size());
+    for (const auto& id : bus_order_) {
+        buses.push_back(buses_.at(id).get());
+    }
+    // Рёбра каждого маршрута считаются независимо, а в граф добавляются
+    // в порядке buses, поэтому номера рёбер не зависят от числа потоков
+    std::vector<std::vector<std::pair<graph::Edge<TimeUnit>, SpanBus>>> bus_edges(buses.size());
+    parallel::ForEachRange(buses.size(), threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const BusDescription& bus = *buses[i];
+            if (bus.stops.empty()) {
+                continue;
+            }
+            std::vector<const DoubleStop*> graph_stops;
+            graph_stops.reserve(bus.stops.size());
+            for (auto from_it = bus.stops.begin(); from_it != bus.stops.end(); ++from_it) {
+                const auto& from = map2stop_.at(*from_it);
+                graph_stops.push_back(&from);
+            }
+            auto& edges = bus_edges[i];
+            for (size_t from = 0; from < graph_stops.size() - 1; ++from) {
+                double travel_time = 0.;
+                for (size_t to = from + 1; to < graph_stops.size(); ++to) {
+                    const auto dist = GetDistance(*descr.at(graph_stops.at(to - 1)->first / 2), *descr.at(graph_stops.at(to)->first / 2));
+                    if (dist) {
+                        travel_time += (60 * static_cast<double>(dist.value()) / velocity) / 1000;
+                        edges.push_back({{graph_stops.at(from)->second, graph_stops.at(to)->first, travel_time},
+                                         {bus.id, to - from, from}});
+                    }
+                }
+            }
+        }
+    });
+    for (size_t i = 0; i < buses.size(); ++i) {
+        for (const auto& [edge, span_bus] : bus_edges[i]) {
+            bus2map_[stop_map_.AddEdge(edge)] = span_bus;
+        }
+    }
+}
+
+void TransportCatalogue::BuildIndexes() {
+    BuildBusses4Stop();
+    BuildStopGrid();
+}
+
+void TransportCatalogue::BuildStopGrid() {
+    std::vector<Coordinates> places;
+    places.reserve(stops_by_index_.size());
+    for (const auto stop : stops_by_index_) {
+        places.push_back(stop->place);
+    }
+    stop_grid_ = GridIndex(places);
+}
+
+void TransportCatalogue::BuildBusses4Stop() {
+    std::vector<std::string_view> buses = GetBuses();
+    std::sort(buses.begin(), buses.end());
+    std::vector<std::vector<size_t>> bus_stops;
+    bus_stops.reserve(buses.size());
+    for (const auto& bus : buses) {
+        auto& indexes = bus_stops.emplace_back();
+        for (const auto& stop : buses_.at(bus)->stops) {
+            indexes.push_back(stops_.at(stop)->index);
         }
-        std::vector<const DoubleStop*> graph_stops;
-        graph_stops.reserve(bus.stops.size());
-        for (auto from_it = bus.stops.begin(); from_it != bus.stops.end(); ++from_it) {
-            const auto& from = map2stop_.at(*from_it);
-            graph_stops.push_back(&from);
+    }
+
+    // Первый проход считает автобусы остановки, второй раскладывает их по местам.
+    // Автобусы обходятся в порядке имён, поэтому каждый отрезок получается отсортированным,
+    // а повторный заезд на остановку отсекается сравнением с последним записанным автобусом.
+    const size_t no_bus = buses.size();
+    std::vector<size_t> last_bus(stops_.size(), no_bus);
+    busses4stop_offsets_.assign(stops_.size() + 1, 0);
+    for (size_t bus = 0; bus < buses.size(); ++bus) {
+        for (const size_t stop : bus_stops[bus]) {
+            if (last_bus[stop] != bus) {
+                last_bus[stop] = bus;
+                ++busses4stop_offsets_[stop + 1];
+            }
         }
-        for (size_t from = 0; from < graph_stops.size() - 1; ++from) {
-            double travel_time = 0.;
-            for (size_t to = from + 1; to < graph_stops.size(); ++to) {
-                const auto dist = GetDistance(*descr.at(graph_stops.at(to - 1)->first / 2), *descr.at(graph_stops.at(to)->first / 2));
-                if (dist) {
-                    travel_time += (60 * static_cast<double>(dist.value()) / velocity) / 1000;
-                    bus2map_[stop_map_.AddEdge({graph_stops.at(from)->second, graph_stops.at(to)->first, travel_time})] = {id, to - from};
-                }
+    }
+    for (size_t stop = 0; stop < stops_.size(); ++stop) {
+        busses4stop_offsets_[stop + 1] += busses4stop_offsets_[stop];
+    }
+
+    busses4stop_.resize(busses4stop_offsets_.back());
+    std::vector<size_t> fill(busses4stop_offsets_.begin(), busses4stop_offsets_.end() - 1);
+    last_bus.assign(stops_.size(), no_bus);
+    for (size_t bus = 0; bus < buses.size(); ++bus) {
+        for (const size_t stop : bus_stops[bus]) {
+            if (last_bus[stop] != bus) {
+                last_bus[stop] = bus;
+                busses4stop_[fill[stop]++] = buses[bus];
             }
         }
     }
@@ -78,7 +235,7 @@ std::optional<RouteDescription> TransportCatalogue::DescribePath(const graph::Ed
             return ans;
         } else {
             const auto span_bus = bus2map_.at(id);
-            RouteDescription ans {PathType::Bus, edge.weight, span_bus.first, span_bus.second};
+            RouteDescription ans {PathType::Bus, edge.weight, span_bus.bus, span_bus.span, span_bus.first_stop};
             return ans;
         }
     }
@@ -96,7 +253,7 @@ const graph::DirectedWeightedGraph<TimeUnit>& TransportCatalogue::GetMapGraph()
 const BusDescription* TransportCatalogue::GetBus(const std::string_view id) const {
     auto bus_ptr = buses_.find(id);
     if (bus_ptr != buses_.end()) {
-        return &bus_ptr->second;
+        return bus_ptr->second.get();
     }
     return nullptr;
 }
@@ -114,37 +271,39 @@ std::optional<int> TransportCatalogue::GetDistance(const StopDescription& from,
 
 const std::optional<RouteStatistics> TransportCatalogue::GetStat(const BusDescription* bus) const {
     if (bus) {
-        double route_length = 0.0;
+        const auto& path = bus->stop_indexes;
         int route_dist = 0;
-        std::unordered_set<std::string_view> unique_stops;
-        std::optional<StopDescription> prev_stop;
-        for (const std::string_view& s : bus->stops) {
-            const auto stop = stops_.at(s);
-            unique_stops.insert(s);
-            if (prev_stop) {
-                const auto dist = GetDistance(*prev_stop, stop);
-                if (dist) {
-                    route_dist += dist.value();
-                } else {
-                    std::stringstream ss;
-                    ss << "distance between stop " << s << " and stop " << prev_stop->id << " not found in base";
-                    throw std::out_of_range(ss.str());
-                }
-                route_length += ComputeDistance(prev_stop->place, stop.place);
+        for (size_t i = 1; i < path.size(); ++i) {
+            const StopDescription& prev_stop = *stops_by_index_[path[i - 1]];
+            const StopDescription& stop = *stops_by_index_[path[i]];
+            const auto dist = GetDistance(prev_stop, stop);
+            if (dist) {
+                route_dist += dist.value();
+            } else {
+                std::stringstream ss;
+                ss << "distance between stop " << stop.id << " and stop " << prev_stop.id << " not found in base";
+                throw std::out_of_range(ss.str());
             }
-            prev_stop = stop;
         }
+        const double route_length = places_.ComputePathLength(path);
+        std::vector<size_t> unique_stops = path;
+        std::sort(unique_stops.begin(), unique_stops.end());
+        unique_stops.erase(std::unique(unique_stops.begin(), unique_stops.end()), unique_stops.end());
         return RouteStatistics {route_dist, bus->stops.size(), unique_stops.size(), route_dist / route_length};
     }
     return std::nullopt;
 }
 
-const std::set<BusPtr>* TransportCatalogue::GetBusses4Stop(const std::string_view id) const {
-    auto busses4stop_ptr = busses4stop_.find(id);
-    if (busses4stop_ptr != busses4stop_.end()) {
-        return &busses4stop_ptr->second;
+std::optional<BusRange> TransportCatalogue::GetBusses4Stop(const std::string_view id) const {
+    const auto stop_ptr = stops_.find(id);
+    if (stop_ptr == stops_.end()) {
+        return std::nullopt;
     }
-    return nullptr;
+    if (busses4stop_offsets_.empty()) {
+        return BusRange {busses4stop_.end(), busses4stop_.end()};
+    }
+    const size_t index = stop_ptr->second->index;
+    return BusRange {busses4stop_.begin() + busses4stop_offsets_[index], busses4stop_.begin() + busses4stop_offsets_[index + 1]};
 }
 
 std::vector<geo::Coordinates> TransportCatalogue::GetStops() const {
@@ -153,7 +312,7 @@ std::vector<geo::Coordinates> TransportCatalogue::GetStops() const {
     ans.reserve(stops.size());
     for (const auto& [id, descr] : stops_) {
         if (stops.count(id) > 0) {
-            ans.push_back(descr.place);
+            ans.push_back(descr->place);
         }
     }
     return ans;
@@ -162,7 +321,7 @@ std::vector<geo::Coordinates> TransportCatalogue::GetStops() const {
 std::set<std::string_view> TransportCatalogue::GetStopIds() const {
     std::set<std::string_view> stops;
     for (const auto& [id, descr] : buses_) {
-        for (const auto& s : descr.stops) {
+        for (const auto& s : descr->stops) {
             stops.insert(s);
         }
     }
@@ -177,10 +336,18 @@ std::vector<std::string_view> TransportCatalogue::GetBuses() const {
     return buses;
 }
 
+std::vector<NearStop> TransportCatalogue::GetNearestStops(const Coordinates place, const double radius, const size_t count) const {
+    std::vector<NearStop> ans;
+    for (const auto& [index, distance] : stop_grid_.FindNearest(place, radius, count)) {
+        ans.push_back({stops_by_index_[index]->id, distance});
+    }
+    return ans;
+}
+
 const StopDescription* TransportCatalogue::GetStop(const std::string_view id) const {
     const auto stop_ptr = stops_.find(id);
     if (stop_ptr != stops_.end()) {
-        return &stop_ptr->second;
+        return stop_ptr->second.get();
     }
     return nullptr;
 }
@@ -9,28 +9,41 @@
 #include <optional>
 #include <unordered_map>
 #include <iostream>
+#include <limits>
 #include <forward_list>
+#include <memory>
 
 #include "graph.h"
+#include "ranges.h"
 #include "geo.h"
+#include "spatial_index.h"
 #include "domain.h"
 
 namespace transport {
     
     using StopsMap = std::unordered_map<std::string_view, int>;
     using BusPtr = std::string_view;
+    using BusRange = ranges::Range<std::vector<BusPtr>::const_iterator>;
 
     
     struct StopDescription {
         std::string_view id;
         geo::Coordinates place;
         StopsMap distances;
+        size_t index = 0;
     };
 
     struct BusDescription {
         std::string_view id;
         std::vector<std::string_view> stops;
         std::vector<std::string_view> final_stops;
+        // StopDescription::index остановок маршрута, в порядке stops
+        std::vector<size_t> stop_indexes;
+    };
+
+    struct NearStop {
+        std::string_view id;
+        double distance;
     };
 
     struct RouteStatistics {
@@ -52,6 +65,8 @@ namespace transport {
         TimeUnit time;
         std::string_view id;
         std::optional<int> span;
+        // Bus: номер остановки посадки в BusDescription::stops
+        size_t first_stop = 0;
     };
     
     struct PathDescription {
@@ -59,8 +74,10 @@ namespace transport {
         std::vector<RouteDescription> route;
     };
     
-    using StopContainer = std::unordered_map<std::string_view, StopDescription>;
-    using BusContainer = std::unordered_map<std::string_view, BusDescription>;
+    // Описания остановок и маршрутов разделяются между версиями справочника
+    // (см. TransportCatalogue::Fork) и копируются только при изменении
+    using StopContainer = std::unordered_map<std::string_view, std::shared_ptr<StopDescription>>;
+    using BusContainer = std::unordered_map<std::string_view, std::shared_ptr<const BusDescription>>;
     
     class TransportStopIterator {
     public:
@@ -70,10 +87,10 @@ namespace transport {
         }
     
         const geo::Coordinates& operator*() const {
-            return it_->second.place;
+            return it_->second->place;
         }
         const geo::Coordinates* operator->() const {
-            return &it_->second.place;
+            return &it_->second->place;
         }
         TransportStopIterator& operator++() {
             ++it_;
@@ -91,30 +108,75 @@ namespace transport {
     
     class TransportCatalogue {
         using DoubleStop = std::pair<graph::VertexId, graph::VertexId>;
-        using SpanBus = std::pair<std::string_view, size_t>;
+        struct SpanBus {
+            std::string_view bus;
+            size_t span = 0;
+            // номер остановки посадки в BusDescription::stops
+            size_t first_stop = 0;
+        };
     public:
+        // Число остановок GetNearestStops без ограничения
+        static constexpr size_t NO_LIMIT = std::numeric_limits<size_t>::max();
+
+        // Повторное добавление остановки или маршрута с тем же именем заменяет прежнее описание
         void AddStop(const std::string_view id, const geo::Coordinates place);
         void AddBus(const std::string_view id, const std::vector<std::string_view>& stops, const std::vector<std::string_view>& final_stops);
         void AddDistance(const std::string_view from, const std::string_view to, const int dists);
-        void BuildMapGraph(const int velocity, const TimeUnit time);
+        // Для массовой загрузки
+        void Reserve(const size_t stops_count, const size_t buses_count);
+        size_t GetStopsCount() const;
+        // Можно вызывать из нескольких потоков одновременно для разных from,
+        // если справочник не разделяет остановки с другими версиями
+        void AddDistances(const std::string_view from, const std::vector<domain::StopDistance>& distances);
+        // Строит описание маршрута, не меняя справочник, поэтому можно вызывать
+        // из нескольких потоков; id указывает на переданную строку до вызова AddBus
+        BusDescription MakeBus(const std::string_view id, const std::vector<std::string_view>& stops, const std::vector<std::string_view>& final_stops) const;
+        void AddBus(BusDescription bus);
+        // Рёбра маршрутов считаются в threads потоках, граф собирается в одном порядке
+        // независимо от числа потоков
+        void BuildMapGraph(const int velocity, const TimeUnit time, const size_t threads = 1);
+        // Строит индексы, которые не меняются после окончания загрузки.
+        // Вызывается после добавления всех остановок и маршрутов, повторный вызов перестраивает их.
+        void BuildIndexes();
+        // Новая версия справочника с теми же остановками, маршрутами и расстояниями.
+        // Описания разделяются с исходной версией и копируются при первом изменении,
+        // таблицы указателей на них копируются целиком, граф и индексы в новой
+        // версии нужно построить заново.
+        // Пул имён общий для всех версий: изменять одновременно можно только одну из них.
+        TransportCatalogue Fork() const;
         const BusDescription* GetBus(const std::string_view id) const;
         const std::optional<RouteStatistics> GetStat(const BusDescription* bus) const;
-        const std::set<BusPtr>* GetBusses4Stop(const std::string_view id) const;
+        std::optional<BusRange> GetBusses4Stop(const std::string_view id) const;
         std::vector<geo::Coordinates> GetStops() const;
         std::set<std::string_view> GetStopIds() const;
         std::vector<std::string_view> GetBuses() const;
         const StopDescription* GetStop(const std::string_view id) const;
+        // Не более count остановок в радиусе radius метров от place, ближайшие первыми;
+        // при count == NO_LIMIT - все остановки в радиусе. Требует BuildIndexes()
+        std::vector<NearStop> GetNearestStops(const geo::Coordinates place, const double radius, const size_t count) const;
         const graph::DirectedWeightedGraph<TimeUnit>& GetMapGraph() const;
         graph::VertexId GetStopGraphId(const std::string_view& id) const;
         std::optional<RouteDescription> DescribePath(const graph::EdgeId& edge) const;
     private:
         std::string_view AddId(const std::string_view id);
+        StopDescription& MutableStop(const std::string_view id);
         std::optional<int> GetDistance(const StopDescription& from, const StopDescription& to) const;
+        void BuildBusses4Stop();
+        void BuildStopGrid();
     private:
-        std::forward_list<std::string> ids_;
+        std::shared_ptr<std::forward_list<std::string>> ids_ = std::make_shared<std::forward_list<std::string>>();
         StopContainer stops_;
+        // остановки в порядке StopDescription::index
+        std::vector<const StopDescription*> stops_by_index_;
+        geo::CoordinatesTable places_;
         BusContainer buses_;
-        std::unordered_map<std::string_view, std::set<std::string_view>> busses4stop_;
+        // имена маршрутов в порядке первого добавления
+        std::vector<std::string_view> bus_order_;
+        // CSR: автобусы остановки с индексом i лежат в busses4stop_
+        // на отрезке [busses4stop_offsets_[i], busses4stop_offsets_[i + 1]), отсортированы
+        std::vector<size_t> busses4stop_offsets_;
+        std::vector<BusPtr> busses4stop_;
+        geo::GridIndex stop_grid_;
         
         std::unordered_map<std::string_view, DoubleStop> map2stop_;
         std::unordered_map<graph::VertexId, std::string_view> stop2map_;
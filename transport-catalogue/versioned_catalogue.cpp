@@ -0,0 +1,43 @@
+#include "versioned_catalogue.h"
+#include "request_handler.h"
+#include "parallel.h"
+
+using namespace transport;
+using namespace handler;
+
+CatalogueSnapshot::CatalogueSnapshot(TransportCatalogue db, uint64_t version) : db_(std::move(db)), router_(db_), version_(version) {
+}
+
+const TransportCatalogue& CatalogueSnapshot::GetCatalogue() const {
+    return db_;
+}
+
+const router::TransportRouter& CatalogueSnapshot::GetRouter() const {
+    return router_;
+}
+
+uint64_t CatalogueSnapshot::GetVersion() const {
+    return version_;
+}
+
+VersionedCatalogue::VersionedCatalogue(const domain::RoutingSettings& settings) : settings_(settings) {
+}
+
+SnapshotPtr VersionedCatalogue::Pin() const {
+    return current_.load(std::memory_order_acquire);
+}
+
+SnapshotPtr VersionedCatalogue::Update(const domain::Commands& commands, std::ostream* timings) {
+    std::lock_guard guard(writer_mutex_);
+    const SnapshotPtr current = current_.load(std::memory_order_acquire);
+    TransportCatalogue next = current ? current->GetCatalogue().Fork() : TransportCatalogue();
+    CatalogueConstructor constructor(next, settings_);
+    if (current) {
+        constructor.FillFromCommands(commands);
+    } else {
+        constructor.BulkFillFromCommands(commands, parallel::GetThreadCount(), timings);
+    }
+    auto snapshot = std::make_shared<const CatalogueSnapshot>(std::move(next), ++last_version_);
+    current_.store(snapshot, std::memory_order_release);
+    return snapshot;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "transport_catalogue.h"
+#include "transport_router.h"
+#include "domain.h"
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+namespace handler {
+
+// Неизменяемая версия справочника вместе с построенным по ней маршрутизатором
+class CatalogueSnapshot {
+public:
+    CatalogueSnapshot(transport::TransportCatalogue db, uint64_t version);
+    CatalogueSnapshot(const CatalogueSnapshot&) = delete;
+    CatalogueSnapshot& operator=(const CatalogueSnapshot&) = delete;
+
+    const transport::TransportCatalogue& GetCatalogue() const;
+    const router::TransportRouter& GetRouter() const;
+    uint64_t GetVersion() const;
+private:
+    const transport::TransportCatalogue db_;
+    const router::TransportRouter router_;
+    const uint64_t version_;
+};
+
+using SnapshotPtr = std::shared_ptr<const CatalogueSnapshot>;
+
+// Справочник с атомарно публикуемыми версиями (в духе RCU).
+// Читатель закрепляет версию через Pin() на всё время обработки пачки запросов
+// и дальше работает с неизменяемыми данными без блокировок; версия живёт,
+// пока на неё есть ссылки. Писатель строит следующую версию из копии текущей,
+// разделяя с ней неизменённые остановки и маршруты, и публикует её одной атомарной записью.
+class VersionedCatalogue {
+public:
+    explicit VersionedCatalogue(const domain::RoutingSettings& settings);
+
+    // Текущая опубликованная версия, nullptr до первого Update
+    SnapshotPtr Pin() const;
+
+    // Применяет к текущей версии добавления и замены остановок, расстояний и маршрутов,
+    // публикует результат как новую версию и возвращает её. Первая версия
+    // загружается массово (CatalogueConstructor::BulkFillFromCommands),
+    // длительности её этапов выводятся в timings, если он задан.
+    // Каждая следующая версия стоит как перестройка всей сети: граф, маршрутизатор
+    // и индексы строятся заново. Маршрутизатор хранит пути между всеми парами
+    // вершин, и любое изменение остановок, расстояний или маршрутов затрагивает их
+    SnapshotPtr Update(const domain::Commands& commands, std::ostream* timings = nullptr);
+
+private:
+    const domain::RoutingSettings settings_;
+    std::mutex writer_mutex_;
+    uint64_t last_version_ = 0;
+    std::atomic<SnapshotPtr> current_;
+};
+
+}